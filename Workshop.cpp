@@ -11,14 +11,218 @@
 #include <conio.h>
 #include <windows.h>
 #include <cmath> 
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <functional>
+#include <map>
+#include <list>
+#include <algorithm>
+#include <execution>
+#include <filesystem>
+#include <io.h>
 
 using namespace std;
 
 // CONSTANTS (Arrays need a fixed size)
 // I set this to 100. If we have more students, the program might break.
 const int MAX_ITEMS = 100;
+const int MAX_REPLICAS = 8;
+const int MAX_SHARDS = 16;
+const int TERM_MONTHS = 4; // terms are 4-month blocks starting in Jan, May and Sep
+
+// ===================== DATABASE CONFIG =====================
+// Loaded from db.ini (or the file in SFAMS_DB_CONFIG). The defaults are the old hardcoded values.
+struct DBConfig {
+    string primaryHost = "tcp://127.0.0.1:3306";
+    string user = "root";
+    string password = "1234";
+    string schema = "studentmansys_v2";
+    string replicaHosts[MAX_REPLICAS];
+    int replicaCount = 0;
+    int maxReplicaLagSec = 5;   // replicas further behind than this are not used
+
+    // Campuses. Each one is a full copy of the schema holding only its own students.
+    // With no shards listed the program works on the primary only, like before.
+    string shardNames[MAX_SHARDS];
+    string shardHosts[MAX_SHARDS];
+    string shardSchemas[MAX_SHARDS];
+    int shardCount = 0;
+};
+
+// One read replica connection and the last time we checked how far behind it is
+struct ReplicaState {
+    sql::Connection* conn = nullptr;
+    bool healthy = false;
+    int lagSec = -1;
+    chrono::steady_clock::time_point lastCheck;
+};
+
+DBConfig dbConfig;
+ReplicaState replicas[MAX_REPLICAS];
+int nextReplica = 0;
+sql::Connection* shardConns[MAX_SHARDS] = {}; // menu thread only; the startup thread hands them over with startup.ready
+
+// ===================== BOUNDED QUEUE =====================
+// Fixed size queue between a producer thread and a consumer thread.
+// push() blocks while the queue is full, so a fast reader can't run ahead of the database.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : items(capacity) {}
+
+    // Returns false if the queue was closed
+    bool push(const T& item) {
+        unique_lock<mutex> lock(m);
+        if (count == items.size()) {
+            fullWaits++;
+            notFull.wait(lock, [this] { return count < items.size() || closed; });
+        }
+        if (closed) return false;
+        items[(head + count) % items.size()] = item;
+        count++;
+        if (count > peak) peak = count;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Waits up to waitMs for an item. Returns false on timeout or when closed and empty.
+    bool pop(T& out, int waitMs) {
+        unique_lock<mutex> lock(m);
+        if (!notEmpty.wait_for(lock, chrono::milliseconds(waitMs), [this] { return count > 0 || closed; })) return false;
+        if (count == 0) return false;
+        out = items[head];
+        head = (head + 1) % items.size();
+        count--;
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        notEmpty.notify_all(); notFull.notify_all();
+    }
+
+    bool isClosed() { lock_guard<mutex> lock(m); return closed && count == 0; }
+    size_t peakSize() { lock_guard<mutex> lock(m); return peak; }
+    long long fullWaitCount() { lock_guard<mutex> lock(m); return fullWaits; }
+
+private:
+    vector<T> items;
+    size_t head = 0, count = 0, peak = 0;
+    long long fullWaits = 0;
+    bool closed = false;
+    mutex m;
+    condition_variable notEmpty, notFull;
+};
+
+// ===================== MONEY =====================
+// Amounts are whole cents in a 64-bit integer so that sums and "is it fully paid"
+// checks are exact. DECIMAL columns are read as text and parsed, never through double,
+// and written back as text ("123.45") which MySQL converts exactly.
+struct Money {
+    int64_t cents = 0;
+
+    static Money fromCents(int64_t c) { Money m; m.cents = c; return m; }
+
+    // Accepts "12", "12.5", "-0.75", "1234.567" (rounded half up to cents). Returns false for junk
+    // and for more than MAX_WHOLE_DIGITS digits before the point (the cents would overflow).
+    static const int MAX_WHOLE_DIGITS = 15;
+    static bool parse(const string& text, Money& out) {
+        size_t i = 0;
+        while (i < text.size() && text[i] == ' ') i++;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) { negative = (text[i] == '-'); i++; }
+        int64_t whole = 0, frac = 0;
+        int fracDigits = 0;
+        bool digits = false, roundUp = false;
+        int wholeDigits = 0;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+            if (whole > 0 || text[i] != '0') wholeDigits++; // leading zeros don't count
+            if (wholeDigits > MAX_WHOLE_DIGITS) return false;
+            whole = whole * 10 + (text[i] - '0'); digits = true;
+        }
+        if (i < text.size() && text[i] == '.') {
+            for (i++; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+                if (fracDigits < 2) { frac = frac * 10 + (text[i] - '0'); fracDigits++; }
+                else if (fracDigits == 2) { roundUp = (text[i] >= '5'); fracDigits++; }
+                digits = true;
+            }
+        }
+        while (i < text.size() && text[i] == ' ') i++;
+        if (!digits || i != text.size()) return false;
+        if (fracDigits == 1) frac *= 10;
+        int64_t c = whole * 100 + frac + (roundUp ? 1 : 0);
+        out.cents = negative ? -c : c;
+        return true;
+    }
+
+    // NULL / empty columns count as 0
+    static Money fromColumn(const string& text) { Money m; parse(text, m); return m; }
+
+    string toString() const {
+        int64_t a = cents < 0 ? -cents : cents;
+        string frac = to_string(a % 100);
+        if (frac.length() < 2) frac = "0" + frac;
+        return (cents < 0 ? "-" : "") + to_string(a / 100) + "." + frac;
+    }
+
+    // Only for drawing bars and percentages
+    double toDouble() const { return cents / 100.0; }
+
+    Money operator+(Money o) const { return fromCents(cents + o.cents); }
+    Money operator-(Money o) const { return fromCents(cents - o.cents); }
+    Money& operator+=(Money o) { cents += o.cents; return *this; }
+    bool operator<(Money o) const { return cents < o.cents; }
+    bool operator>(Money o) const { return cents > o.cents; }
+    bool operator<=(Money o) const { return cents <= o.cents; }
+    bool operator>=(Money o) const { return cents >= o.cents; }
+    bool operator==(Money o) const { return cents == o.cents; }
+};
+
+// Sums a column of cents. Four independent accumulators with no branches, so the
+// compiler can turn the loop into SIMD adds (/O2 or -O2), and the result is exact.
+int64_t sumCents(const int64_t* values, size_t n) {
+    int64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a0 += values[i]; a1 += values[i + 1]; a2 += values[i + 2]; a3 += values[i + 3];
+    }
+    for (; i < n; i++) a0 += values[i];
+    return a0 + a1 + a2 + a3;
+}
+
+// Largest value in a column of cents (0 for an empty column)
+int64_t maxCents(const int64_t* values, size_t n) {
+    int64_t m0 = 0, m1 = 0, m2 = 0, m3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        m0 = values[i] > m0 ? values[i] : m0;
+        m1 = values[i + 1] > m1 ? values[i + 1] : m1;
+        m2 = values[i + 2] > m2 ? values[i + 2] : m2;
+        m3 = values[i + 3] > m3 ? values[i + 3] : m3;
+    }
+    for (; i < n; i++) m0 = values[i] > m0 ? values[i] : m0;
+    int64_t a = m0 > m1 ? m0 : m1, b = m2 > m3 ? m2 : m3;
+    return a > b ? a : b;
+}
 
 // ===================== FUNCTION PROTOTYPES =====================
+class StudentCache;
+class TeacherRoster;
+
 void setColor(int color);
 void gotoxy(int x, int y);
 void hideCursor();
@@ -31,21 +235,42 @@ void drawSuccess(const string& message);
 void drawError(const string& message);
 
 void drawMenuFrame(const string& title, string options[], int optionCount, int selected);
-void drawLoadingScreen(sql::Connection* conn);
-void printReceipt(string ref, string date, string sName, string fName, double amount);
+void printReceipt(string ref, string date, string sName, string fName, Money amount);
 
+void loadDBConfig(const string& path);
+sql::Connection* openConnection(const string& host, const string& schema = "");
+sql::Connection* shardConnection(int shard);
+int chooseCampus();
 sql::Connection* connectDB();
+void beginStartup();
+void endStartup();
+void markStartup(const string& step);
+string startupStatus();
+void drawStartupStatus();
+sql::Connection* waitForDatabase();
+void writeStartupLog();
+void startupWorker();
+sql::Connection* readConnection(sql::Connection* primary);
+bool checkReplica(ReplicaState& rep);
+void closeReplicas();
+void targetOf(sql::Connection* conn, string& outHost, string& outSchema);
+string ensureSchema(sql::Connection* conn);
+bool columnExists(sql::Connection* conn, const string& table, const string& column);
+bool tableExists(sql::Connection* conn, const string& table);
+bool indexExists(sql::Connection* conn, const string& table, const string& index);
 int getStudentID(sql::Connection* conn, string username);
-bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName, double& outFee);
+bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName, Money& outFee);
 
-void viewAttendance(sql::Connection* conn, int studentID);
-void takeAttendance(sql::Connection* conn, int teacherID);
+void viewAttendance(sql::Connection* conn, int studentID, StudentCache* cache = nullptr);
+void showAttendancePeriod(sql::Connection* conn, int studentID, const string& periodStart, bool weekly);
+int attendanceColor(double rate);
+void takeAttendance(sql::Connection* conn, int teacherID, TeacherRoster* roster = nullptr);
 
-void payFees(sql::Connection* conn, string studentUsername);
-void showMyScore(sql::Connection* conn, int studentID);
-void showPaymentHistory(sql::Connection* conn, int studentID);
+void payFees(sql::Connection* conn, string studentUsername, StudentCache* cache = nullptr);
+void showMyScore(sql::Connection* conn, int studentID, StudentCache* cache = nullptr);
+void showPaymentHistory(sql::Connection* conn, int studentID, StudentCache* cache = nullptr);
 
-void updateStudent(sql::Connection* conn, string username);
+void updateStudent(sql::Connection* conn, string username, StudentCache* cache = nullptr);
 void updateTeacher(sql::Connection* conn, string username);
 void deleteUser(sql::Connection* conn);
 
@@ -54,7 +279,47 @@ void listRecords(sql::Connection* conn);
 // Analytics Functions
 void showAdminStats(sql::Connection* conn);
 void showReliabilityScore(sql::Connection* conn);
+int gradeIndex(double score);
+void gradeHistogram(const double* scores, size_t n, size_t counts[]);
+double scoreAtFraction(vector<double>& scores, double p);
 void showDebtList(sql::Connection* conn);
+void showAtRiskStudents(sql::Connection* conn);
+
+// Data Tools (batch jobs that work on the whole database)
+void dataToolsMenu(sql::Connection* conn);
+void exportLedger(sql::Connection* conn);
+void rebuildCourseRevenue(sql::Connection* conn, bool interactive);
+bool selectFee(sql::Connection* conn, int& outFeeID, string& outFeeName, Money& outAmount);
+void runBilling(sql::Connection* conn);
+void ingestTapLog(sql::Connection* conn);
+string feeStatusFor(Money due, Money paid);
+void reconcileLedger(sql::Connection* conn);
+void ensureArchiveTables(sql::Connection* conn);
+int createArchiveJob(sql::Connection* conn);
+int pickArchiveJob(sql::Connection* conn);
+void archiveStudents(sql::Connection* conn);
+string termStart(const string& date);
+void writeBalanceCheckpoint(sql::Connection* conn, int studentID);
+void showBalanceAsOf(sql::Connection* conn);
+string addTerms(const string& start, int terms);
+void ensureTermPartition(sql::Connection* conn, const string& history, const string& term, const string& termEnd);
+void tierClosedTerms(sql::Connection* conn);
+void generateReminders(sql::Connection* conn);
+void showChangeLog();
+int refreshAging(sql::Connection* conn, const string& filter, const vector<string>& params);
+int refreshAgingAll(sql::Connection* conn);
+int sweepAging(sql::Connection* conn);
+void sweepAgingAll(sql::Connection* conn);
+void termRollover(sql::Connection* conn);
+struct SeatTables;
+bool reserveSeat(sql::Connection* conn, int studentID, int courseID, const SeatTables& t);
+int waitlistPosition(sql::Connection* conn, int studentID, int courseID);
+int promoteWaitlist(sql::Connection* conn, int courseID);
+void seatStressTest(sql::Connection* conn);
+bool isValidDate(const string& s);
+double secondsSince(chrono::steady_clock::time_point start);
+void appendCsvField(string& rec, const string& v);
+void appendBinString(string& rec, const string& v);
 
 void addCourse(sql::Connection* conn);
 void editCourse(sql::Connection* conn);
@@ -63,9 +328,1047 @@ void removeCourse(sql::Connection* conn);
 void adminMenu(sql::Connection* conn, string username);
 void teacherMenu(sql::Connection* conn, string username);
 void studentMenu(sql::Connection* conn, string username);
-int login(sql::Connection* conn, string role, string& outUser);
+int login(sql::Connection* conn, string role, string& outUser, sql::Connection*& outHome);
 void registerUser(sql::Connection* conn);
 
+// ===================== ASYNC QUERY POOL =====================
+// The MySQL connector only has blocking calls, so "async" here means handing a query
+// to a small pool of worker threads, each with its own connection. A screen submits
+// its independent queries together and then waits on the futures, so it pays for
+// the slowest query instead of the sum of all of them.
+
+// A fully read result. Values are kept as text (NULL becomes "").
+struct QueryResult {
+    vector<vector<string>> rows;
+    string error;
+    double ms = 0; // time spent running the query on the worker
+
+    bool ok() const { return error.empty(); }
+    size_t size() const { return rows.size(); }
+    string text(size_t row, size_t col) const { return (row < rows.size() && col < rows[row].size()) ? rows[row][col] : ""; }
+    double num(size_t row, size_t col) const { return atof(text(row, col).c_str()); }
+    int integer(size_t row, size_t col) const { return atoi(text(row, col).c_str()); }
+    Money money(size_t row, size_t col) const { return Money::fromColumn(text(row, col)); }
+};
+
+class QueryPool {
+public:
+    QueryPool(const string& host, const string& schema, int workerCount) : host(host), schema(schema) {
+        for (int i = 0; i < workerCount; i++) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~QueryPool() {
+        { lock_guard<mutex> lock(m); stopping = true; }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    // Runs the query on a worker. params are bound in order with setString.
+    future<QueryResult> submit(const string& sql, const vector<string>& params = {}) {
+        auto job = make_shared<packaged_task<QueryResult(sql::Connection*)>>([sql, params](sql::Connection* conn) {
+            QueryResult res;
+            if (!conn) { res.error = "No database connection."; return res; }
+            auto start = chrono::steady_clock::now();
+            try {
+                sql::PreparedStatement* p = conn->prepareStatement(sql);
+                for (size_t i = 0; i < params.size(); i++) p->setString((unsigned int)i + 1, params[i]);
+                sql::ResultSet* r = p->executeQuery();
+                unsigned int cols = r->getMetaData()->getColumnCount();
+                while (r->next()) {
+                    vector<string> row(cols);
+                    for (unsigned int c = 0; c < cols; c++) row[c] = r->getString(c + 1);
+                    res.rows.push_back(row);
+                }
+                delete r; delete p;
+            }
+            catch (sql::SQLException& e) { res.error = e.what(); }
+            res.ms = secondsSince(start) * 1000.0;
+            return res;
+        });
+        future<QueryResult> f = job->get_future();
+        {
+            lock_guard<mutex> lock(m);
+            jobs.push_back([job](sql::Connection* conn) { (*job)(conn); });
+        }
+        wake.notify_one();
+        return f;
+    }
+
+private:
+    void workerLoop() {
+        sql::mysql::get_driver_instance()->threadInit();
+        sql::Connection* conn = nullptr;
+        while (true) {
+            function<void(sql::Connection*)> job;
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) break;
+                job = jobs.front(); jobs.pop_front();
+            }
+            // Connect on first use, and again if the server dropped us
+            if (conn && !conn->isValid()) { delete conn; conn = nullptr; }
+            if (!conn) { try { conn = openConnection(host, schema); } catch (sql::SQLException&) { conn = nullptr; } }
+            job(conn);
+        }
+        delete conn;
+        sql::mysql::get_driver_instance()->threadEnd();
+    }
+
+    string host, schema;
+    vector<thread> workers;
+    deque<function<void(sql::Connection*)>> jobs;
+    mutex m;
+    condition_variable wake;
+    bool stopping = false;
+};
+
+map<string, QueryPool*> queryPools;
+
+mutex queryPoolsMutex; // the startup thread warms pools while the menu is up
+
+// One pool per server + schema, created the first time a screen needs it
+QueryPool& queryPoolFor(const string& host, const string& schema) {
+    lock_guard<mutex> lock(queryPoolsMutex);
+    QueryPool*& pool = queryPools[host + "|" + schema];
+    if (!pool) pool = new QueryPool(host, schema, 5); // enough for the dashboard's five queries
+    return *pool;
+}
+
+QueryPool& queryPoolFor(sql::Connection* conn) {
+    string host, schema;
+    targetOf(conn, host, schema);
+    return queryPoolFor(host, schema);
+}
+
+// Result of one query from one campus
+struct ShardResult {
+    string campus;
+    QueryResult result;
+};
+
+// A query that has been sent to one campus but not collected yet
+struct PendingShard {
+    string campus;
+    future<QueryResult> result;
+};
+
+// Sends the same query to every campus. Without shards it just goes to conn's server
+// (which may be a read replica).
+vector<PendingShard> scatterSubmit(sql::Connection* conn, const string& sql, const vector<string>& params = {}) {
+    vector<PendingShard> pending;
+    if (dbConfig.shardCount == 0) pending.push_back({ "Main", queryPoolFor(conn).submit(sql, params) });
+    for (int i = 0; i < dbConfig.shardCount; i++) {
+        pending.push_back({ dbConfig.shardNames[i], queryPoolFor(dbConfig.shardHosts[i], dbConfig.shardSchemas[i]).submit(sql, params) });
+    }
+    return pending;
+}
+
+vector<ShardResult> scatterWait(vector<PendingShard>& pending) {
+    vector<ShardResult> out;
+    for (PendingShard& p : pending) out.push_back({ p.campus, p.result.get() });
+    return out;
+}
+
+// Runs the same query on every campus in parallel and returns one result per campus
+vector<ShardResult> scatterQuery(sql::Connection* conn, const string& sql, const vector<string>& params = {}) {
+    vector<PendingShard> pending = scatterSubmit(conn, sql, params);
+    return scatterWait(pending);
+}
+
+// Returns the first error from a scatter, or "" if every campus answered
+string scatterError(const vector<ShardResult>& parts) {
+    for (const ShardResult& p : parts) {
+        if (!p.result.ok()) return p.campus + ": " + p.result.error;
+    }
+    return "";
+}
+
+// One line per campus with how long its part took
+void printShardTimings(const vector<ShardResult>& parts) {
+    if (dbConfig.shardCount == 0) return;
+    setColor(8);
+    cout << "\n   Campus timings: ";
+    for (const ShardResult& p : parts) cout << p.campus << " " << fixed << setprecision(0) << p.result.ms << " ms (" << p.result.size() << " rows)  ";
+    cout << endl;
+    setColor(7);
+}
+
+void closeQueryPools() {
+    for (auto& kv : queryPools) delete kv.second;
+    queryPools.clear();
+}
+
+// ===================== QUERY RESULT CACHE =====================
+// The record lists, the course picker and the enrollment chart run the same queries
+// again and again. Their results are kept here, keyed by server + SQL + parameters.
+// Each entry remembers the version of every table it read; the write paths call
+// bumpTables() for what they change, and any entry that read one of those is stale.
+// Entries also expire after a minute so changes made from other desks show up.
+const size_t RESULT_CACHE_BYTES = 8 * 1024 * 1024;
+const int RESULT_CACHE_SECONDS = 60;
+
+class ResultCache {
+public:
+    // Table versions as of now. Take this BEFORE sending the query, so a write that
+    // commits while it runs leaves the stored entry already stale.
+    vector<uint64_t> snapshot(const vector<string>& tables) {
+        lock_guard<mutex> lock(m);
+        vector<uint64_t> v;
+        for (const string& t : tables) v.push_back(versions[t]);
+        v.push_back(epoch);
+        return v;
+    }
+
+    bool lookup(const string& key, QueryResult& out) {
+        lock_guard<mutex> lock(m);
+        auto it = index.find(key);
+        if (it == index.end()) { misses++; return false; }
+        Entry& e = *it->second;
+        bool current = secondsSince(e.stored) < RESULT_CACHE_SECONDS && e.versions.back() == epoch;
+        for (size_t i = 0; current && i < e.tables.size(); i++) current = (versions[e.tables[i]] == e.versions[i]);
+        if (!current) { invalidations++; misses++; drop(it->second); return false; }
+        lru.splice(lru.begin(), lru, it->second); // most recently used goes to the front
+        hits++;
+        out = e.result;
+        return true;
+    }
+
+    void store(const string& key, const vector<string>& tables, const vector<uint64_t>& seen, const QueryResult& res) {
+        if (!res.ok()) return; // errors are not cached
+        size_t size = sizeof(Entry) + key.size() * 2;
+        for (const auto& row : res.rows) for (const string& cell : row) size += sizeof(string) + cell.size();
+        if (size > RESULT_CACHE_BYTES / 4) return; // one huge list would push everything else out
+        lock_guard<mutex> lock(m);
+        auto it = index.find(key);
+        if (it != index.end()) drop(it->second);
+        lru.push_front({ key, res, tables, seen, chrono::steady_clock::now(), size });
+        index[key] = lru.begin();
+        bytes += size;
+        while (bytes > RESULT_CACHE_BYTES && !lru.empty()) { evictions++; drop(prev(lru.end())); }
+    }
+
+    void bump(const vector<string>& tables) {
+        lock_guard<mutex> lock(m);
+        for (const string& t : tables) versions[t]++;
+    }
+
+    // For jobs that rewrite many tables at once
+    void bumpAll() {
+        lock_guard<mutex> lock(m);
+        epoch++;
+    }
+
+    void printStats() {
+        lock_guard<mutex> lock(m);
+        uint64_t lookups = hits + misses;
+        setColor(8);
+        cout << "\n   Result cache: " << hits << " hits / " << misses << " misses";
+        if (lookups > 0) cout << " (" << fixed << setprecision(0) << (100.0 * hits / lookups) << "%)";
+        cout << ", " << lru.size() << " entries, " << (bytes / 1024) << " KB, " << evictions << " evicted, " << invalidations << " stale" << endl;
+        setColor(7);
+    }
+
+private:
+    struct Entry {
+        string key;
+        QueryResult result;
+        vector<string> tables;
+        vector<uint64_t> versions; // one per table, then the epoch
+        chrono::steady_clock::time_point stored;
+        size_t bytes;
+    };
+
+    void drop(list<Entry>::iterator e) {
+        bytes -= e->bytes;
+        index.erase(e->key);
+        lru.erase(e);
+    }
+
+    list<Entry> lru; // most recently used first
+    unordered_map<string, list<Entry>::iterator> index;
+    map<string, uint64_t> versions;
+    uint64_t epoch = 0;
+    size_t bytes = 0;
+    uint64_t hits = 0, misses = 0, evictions = 0, invalidations = 0;
+    mutex m;
+};
+
+ResultCache resultCache;
+
+// Write paths call this after they commit, with every table they changed
+void bumpTables(const vector<string>& tables) { resultCache.bump(tables); }
+
+// Whitespace differences (line breaks, double spaces) don't make a different query.
+// Quoted text is left alone.
+string normalizeSql(const string& sql) {
+    string out;
+    char quote = 0;
+    bool space = false;
+    for (char c : sql) {
+        if (quote) { out += c; if (c == quote) quote = 0; continue; }
+        if (isspace((unsigned char)c)) { space = true; continue; }
+        if (space && !out.empty()) out += ' ';
+        space = false;
+        if (c == '\'' || c == '"' || c == '`') quote = c;
+        out += c;
+    }
+    return out;
+}
+
+string resultCacheKey(const string& host, const string& schema, const string& sql, const vector<string>& params) {
+    string key = host + "|" + schema + "|" + normalizeSql(sql);
+    for (const string& p : params) key += '\x1f' + p;
+    return key;
+}
+
+// Like queryPoolFor(conn).submit(sql, params).get(), but answered from the cache when
+// none of the listed tables changed since the result was stored
+QueryResult cachedQuery(sql::Connection* conn, const string& sql, const vector<string>& params, const vector<string>& tables) {
+    string host, schema;
+    targetOf(conn, host, schema);
+    string key = resultCacheKey(host, schema, sql, params);
+    QueryResult res;
+    if (resultCache.lookup(key, res)) return res;
+    vector<uint64_t> seen = resultCache.snapshot(tables);
+    res = queryPoolFor(host, schema).submit(sql, params).get();
+    resultCache.store(key, tables, seen, res);
+    return res;
+}
+
+// scatterQuery() through the cache. Each campus is cached separately, and only the
+// campuses that missed are sent the query.
+vector<ShardResult> cachedScatter(sql::Connection* conn, const string& sql, const vector<string>& tables) {
+    vector<string> hosts, schemas, campuses;
+    if (dbConfig.shardCount == 0) {
+        string host, schema;
+        targetOf(conn, host, schema);
+        hosts.push_back(host); schemas.push_back(schema); campuses.push_back("Main");
+    }
+    for (int i = 0; i < dbConfig.shardCount; i++) {
+        hosts.push_back(dbConfig.shardHosts[i]); schemas.push_back(dbConfig.shardSchemas[i]); campuses.push_back(dbConfig.shardNames[i]);
+    }
+
+    vector<ShardResult> out(hosts.size());
+    vector<future<QueryResult>> pending(hosts.size());
+    vector<uint64_t> seen = resultCache.snapshot(tables);
+    for (size_t i = 0; i < hosts.size(); i++) {
+        out[i].campus = campuses[i];
+        if (!resultCache.lookup(resultCacheKey(hosts[i], schemas[i], sql, {}), out[i].result)) pending[i] = queryPoolFor(hosts[i], schemas[i]).submit(sql);
+    }
+    for (size_t i = 0; i < hosts.size(); i++) {
+        if (!pending[i].valid()) continue;
+        out[i].result = pending[i].get();
+        resultCache.store(resultCacheKey(hosts[i], schemas[i], sql, {}), tables, seen, out[i].result);
+    }
+    return out;
+}
+
+// ===================== CHANGE LOG =====================
+// Every committed write also appends a small binary event to a local log in changes\,
+// so other code (caches, summaries, exports) can follow what changed from an offset
+// instead of rescanning tables. The log is append only and split into segment files
+// named by the offset of their first event. Appends are buffered and a flusher thread
+// writes and fsyncs them in groups, so writers that commit together share one fsync.
+// Events are written after the database commit: a crash in between can lose an event,
+// never invent one.
+const string CHANGE_LOG_DIR = "changes";
+const size_t CHANGE_SEGMENT_BYTES = 16 * 1024 * 1024;
+const int GROUP_COMMIT_MS = 5; // how long the flusher waits for more events to share an fsync
+
+enum ChangeType : uint8_t {
+    EV_PAYMENT = 1, EV_ATTENDANCE, EV_STUDENT_ADDED, EV_TEACHER_ADDED, EV_ENROLLED, EV_WAITLISTED,
+    EV_COURSE_ADDED, EV_COURSE_CHANGED, EV_COURSE_REMOVED, EV_STUDENT_DELETED, EV_TEACHER_DELETED,
+    EV_STUDENT_UPDATED, EV_TEACHER_UPDATED, EV_BULK_JOB, EV_TYPE_COUNT
+};
+
+const string CHANGE_TYPE_NAMES[EV_TYPE_COUNT] = {
+    "?", "Payment", "Attendance", "StudentAdded", "TeacherAdded", "Enrolled", "Waitlisted",
+    "CourseAdded", "CourseChanged", "CourseRemoved", "StudentDeleted", "TeacherDeleted",
+    "StudentUpdated", "TeacherUpdated", "BulkJob"
+};
+
+// key1/key2 are the ids the event is about (StudentID, CourseID, SFID ...), cents any
+// amount, text a short string (reference, status, username). Which is which depends on type.
+struct ChangeEvent {
+    uint8_t type = 0;
+    int64_t timeMs = 0; // ms since 1970, filled in by append()
+    int32_t key1 = 0, key2 = 0;
+    int64_t cents = 0;
+    string text;
+    uint64_t offset = 0; // where the event starts, filled in by ChangeReader
+};
+
+// On disk: [uint32 payload length][uint32 FNV-1a of payload][payload]
+// payload: type u8, timeMs i64, key1 i32, key2 i32, cents i64, text length u16, text
+uint32_t fnv1a(const char* data, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) { h ^= (unsigned char)data[i]; h *= 16777619u; }
+    return h;
+}
+
+string encodeChange(const ChangeEvent& ev) {
+    string payload;
+    payload += (char)ev.type;
+    payload.append((const char*)&ev.timeMs, sizeof(ev.timeMs));
+    payload.append((const char*)&ev.key1, sizeof(ev.key1));
+    payload.append((const char*)&ev.key2, sizeof(ev.key2));
+    payload.append((const char*)&ev.cents, sizeof(ev.cents));
+    uint16_t len = (uint16_t)min(ev.text.size(), (size_t)65535);
+    payload.append((const char*)&len, sizeof(len));
+    payload.append(ev.text, 0, len);
+
+    uint32_t size = (uint32_t)payload.size(), sum = fnv1a(payload.data(), payload.size());
+    string rec((const char*)&size, sizeof(size));
+    rec.append((const char*)&sum, sizeof(sum));
+    return rec + payload;
+}
+
+bool decodeChange(const string& payload, ChangeEvent& ev) {
+    const size_t FIXED = 1 + 8 + 4 + 4 + 8 + 2;
+    if (payload.size() < FIXED) return false;
+    const char* p = payload.data();
+    ev.type = (uint8_t)p[0];
+    memcpy(&ev.timeMs, p + 1, 8);
+    memcpy(&ev.key1, p + 9, 4);
+    memcpy(&ev.key2, p + 13, 4);
+    memcpy(&ev.cents, p + 17, 8);
+    uint16_t len; memcpy(&len, p + 25, 2);
+    if (payload.size() != FIXED + len) return false;
+    ev.text.assign(p + FIXED, len);
+    return true;
+}
+
+// Reads the record at the file's current position. False at the end of the file or
+// at a torn (half written) record.
+bool readChangeRecord(FILE* f, ChangeEvent& ev, size_t& recordBytes) {
+    uint32_t head[2];
+    if (fread(head, sizeof(uint32_t), 2, f) != 2) return false;
+    if (head[0] > 65536) return false;
+    string payload(head[0], '\0');
+    if (fread(&payload[0], 1, head[0], f) != head[0]) return false;
+    if (fnv1a(payload.data(), payload.size()) != head[1] || !decodeChange(payload, ev)) return false;
+    recordBytes = 8 + head[0];
+    return true;
+}
+
+string segmentPath(const string& dir, uint64_t start) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020llu.seg", (unsigned long long)start);
+    return dir + "\\" + name;
+}
+
+// Start offsets of the segments in dir, oldest first
+vector<uint64_t> listSegments(const string& dir) {
+    vector<uint64_t> starts;
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (name.size() == 24 && name.substr(20) == ".seg") starts.push_back(strtoull(name.c_str(), nullptr, 10));
+    }
+    sort(starts.begin(), starts.end());
+    return starts;
+}
+
+class ChangeLog {
+public:
+    ~ChangeLog() { close(); }
+
+    // Queues an event and returns the offset just past it. Does not wait for the disk.
+    uint64_t append(ChangeEvent ev) {
+        ev.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        string rec = encodeChange(ev);
+        lock_guard<mutex> lock(m);
+        if (!opened) openLocked();
+        if (!lastError.empty()) return 0;
+        pending += rec;
+        endOffset += rec.size();
+        appended++;
+        wake.notify_one();
+        return endOffset;
+    }
+
+    // Waits until everything before 'offset' has been fsynced
+    void waitDurable(uint64_t offset) {
+        unique_lock<mutex> lock(m);
+        synced.wait(lock, [&] { return durableOffset >= offset || !lastError.empty() || !opened; });
+    }
+
+    // Flushes what is queued and stops the flusher
+    void close() {
+        {
+            lock_guard<mutex> lock(m);
+            if (!opened) return;
+            stopping = true;
+        }
+        wake.notify_all();
+        if (flusher.joinable()) flusher.join();
+        if (file) fclose(file);
+        file = nullptr;
+        opened = false;
+        synced.notify_all();
+    }
+
+    void printStats() {
+        lock_guard<mutex> lock(m);
+        cout << "   Log end offset:    " << endOffset << "  (durable " << durableOffset << ")" << endl;
+        cout << "   This session:      " << appended << " events, " << fsyncs << " fsyncs" << endl;
+        if (!lastError.empty()) { setColor(12); cout << "   Error:             " << lastError << endl; setColor(7); }
+    }
+
+private:
+    // Finds where the log ends. A torn record at the end of the last segment (crash
+    // mid-write) is left behind and a new segment starts at the last good event.
+    void openLocked() {
+        opened = true;
+        stopping = false;
+        error_code ec;
+        filesystem::create_directories(CHANGE_LOG_DIR, ec);
+        vector<uint64_t> starts = listSegments(CHANGE_LOG_DIR);
+        segmentStart = starts.empty() ? 0 : starts.back();
+        segmentBytes = 0;
+        bool torn = false;
+        if (!starts.empty()) {
+            FILE* f = fopen(segmentPath(CHANGE_LOG_DIR, segmentStart).c_str(), "rb");
+            if (f) {
+                ChangeEvent ev; size_t n;
+                while (readChangeRecord(f, ev, n)) segmentBytes += n;
+                fseek(f, 0, SEEK_END);
+                torn = (size_t)ftell(f) > segmentBytes;
+                fclose(f);
+            }
+        }
+        if (torn && segmentBytes > 0) { segmentStart += segmentBytes; segmentBytes = 0; torn = false; }
+        // A segment with nothing readable in it is started over
+        file = fopen(segmentPath(CHANGE_LOG_DIR, segmentStart).c_str(), torn ? "wb" : "ab");
+        if (!file) { lastError = "Cannot open " + segmentPath(CHANGE_LOG_DIR, segmentStart); return; }
+        endOffset = durableOffset = segmentStart + segmentBytes;
+        flusher = thread([this] { flusherLoop(); });
+    }
+
+    void flusherLoop() {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break; // stopping, nothing left
+            // Give other writers a moment to join this fsync
+            if (!stopping) { lock.unlock(); this_thread::sleep_for(chrono::milliseconds(GROUP_COMMIT_MS)); lock.lock(); }
+            string batch;
+            batch.swap(pending);
+            uint64_t batchEnd = endOffset;
+            lock.unlock();
+
+            string err = writeBatch(batch);
+
+            lock.lock();
+            if (!err.empty()) { lastError = err; pending.clear(); }
+            else { durableOffset = batchEnd; fsyncs++; }
+            synced.notify_all();
+        }
+    }
+
+    // Only the flusher thread touches the file
+    string writeBatch(const string& batch) {
+        if (segmentBytes > 0 && segmentBytes + batch.size() > CHANGE_SEGMENT_BYTES) {
+            fclose(file);
+            segmentStart += segmentBytes;
+            segmentBytes = 0;
+            file = fopen(segmentPath(CHANGE_LOG_DIR, segmentStart).c_str(), "ab");
+            if (!file) return "Cannot open " + segmentPath(CHANGE_LOG_DIR, segmentStart);
+        }
+        if (fwrite(batch.data(), 1, batch.size(), file) != batch.size() || fflush(file) != 0 || _commit(_fileno(file)) != 0) return "Write to the change log failed";
+        segmentBytes += batch.size();
+        return "";
+    }
+
+    mutex m;
+    condition_variable wake, synced;
+    thread flusher;
+    bool opened = false, stopping = false;
+    string pending;         // encoded events not written yet
+    uint64_t endOffset = 0, durableOffset = 0;
+    uint64_t segmentStart = 0;
+    size_t segmentBytes = 0;
+    FILE* file = nullptr;
+    long long appended = 0, fsyncs = 0;
+    string lastError;
+};
+
+ChangeLog changeLog;
+
+// For the write paths: records one committed change and waits for it to be on disk
+void emitChange(uint8_t type, int key1, int key2, int64_t cents, const string& text) {
+    ChangeEvent ev;
+    ev.type = type; ev.key1 = key1; ev.key2 = key2; ev.cents = cents; ev.text = text;
+    changeLog.waitDurable(changeLog.append(ev));
+}
+
+// The Data Tools jobs log one event per run, after their last commit: key1 = rows (or
+// students) they committed, key2 = the job's own id where it has one (FeeID, JobID)
+void emitBulkJob(const string& job, long long rows, int id = 0) {
+    if (rows > 0) emitChange(EV_BULK_JOB, (int)min(rows, (long long)INT32_MAX), id, 0, job);
+}
+
+// Consumer side: reads the log from an offset (0 = the beginning, or a position()
+// saved earlier), crossing into the next segment at the end of each one. next()
+// returns false when it has caught up; calling it again later picks up new events.
+class ChangeReader {
+public:
+    ChangeReader(const string& dir, uint64_t offset) : dir(dir), pos(offset) {}
+    ~ChangeReader() { if (file) fclose(file); }
+
+    uint64_t position() const { return pos; }
+
+    bool next(ChangeEvent& ev) {
+        while (true) {
+            if (!file && !openSegment()) return false;
+            fseek(file, (long)(pos - segmentStart), SEEK_SET);
+            size_t n;
+            if (readChangeRecord(file, ev, n)) { ev.offset = pos; pos += n; return true; }
+            // End of this segment (or a torn tail): go on only if a later segment starts here
+            vector<uint64_t> starts = listSegments(dir);
+            if (find(starts.begin(), starts.end(), pos) == starts.end() || pos == segmentStart) return false;
+            fclose(file); file = nullptr;
+        }
+    }
+
+private:
+    // Opens the segment holding pos
+    bool openSegment() {
+        vector<uint64_t> starts = listSegments(dir);
+        auto it = upper_bound(starts.begin(), starts.end(), pos);
+        if (it == starts.begin()) return false;
+        segmentStart = *(it - 1);
+        file = fopen(segmentPath(dir, segmentStart).c_str(), "rb");
+        return file != nullptr;
+    }
+
+    string dir;
+    uint64_t pos;
+    uint64_t segmentStart = 0;
+    FILE* file = nullptr;
+};
+
+// ===================== ATTENDANCE WINDOWS =====================
+// Per student ring buffer of daily present/total counts, so "last 4 weeks" and
+// "this term" attendance can be read in O(1) without rescanning ATTENDANCE.
+// Filled once from the database, then kept current by roll call saves (TeacherRoster::save).
+const int WINDOW_RECENT_DAYS = 28;  // last 4 weeks
+const int WINDOW_TERM_DAYS = TERM_MONTHS * 31; // ring size, longer than any term
+const int WINDOW_RELOAD_SEC = 300;  // pick up writes from other PCs every 5 minutes
+
+// Days since 1970-01-01 for "YYYY-MM-DD" (-1 if it isn't a date)
+int dayNumber(const string& date) {
+    if (date.length() < 10 || !isValidDate(date.substr(0, 10))) return -1;
+    int y = atoi(date.c_str()), m = atoi(date.c_str() + 5), d = atoi(date.c_str() + 8);
+    y -= (m <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Inverse of dayNumber()
+string dateOfDay(int day) {
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int doe = day - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = yoe + era * 400 + (m <= 2);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d", y, m, d);
+    return buf;
+}
+
+int todayNumber() {
+    time_t t = time(0); struct tm* now = localtime(&t); char buf[16]; strftime(buf, sizeof(buf), "%Y-%m-%d", now);
+    return dayNumber(buf);
+}
+
+// First day of the term 'day' is in, as a day number
+int termFirstDayOf(int day) {
+    return dayNumber(termStart(dateOfDay(day)));
+}
+
+struct AttendanceWindow {
+    unsigned short present[WINDOW_TERM_DAYS] = {};
+    unsigned short total[WINDOW_TERM_DAYS] = {};
+    int headDay = -1;      // newest day in the ring
+    int termFirstDay = -1; // first day of headDay's term; the term counts start here
+    int recentPresent = 0, recentTotal = 0;
+    int termPresent = 0, termTotal = 0;
+
+    // Moves the ring forward to 'day', dropping days that fall out of each window.
+    // The term counts restart when 'day' is in a new term; the ring is longer than a
+    // term, so the slot being reused is never part of the current term.
+    void advanceTo(int day) {
+        if (headDay == -1) { headDay = day; termFirstDay = termFirstDayOf(day); return; }
+        if (day - headDay >= WINDOW_TERM_DAYS) { *this = AttendanceWindow(); advanceTo(day); return; }
+        if (day <= headDay) return;
+        int first = termFirstDayOf(day);
+        if (first != termFirstDay) { termFirstDay = first; termPresent = 0; termTotal = 0; }
+        while (headDay < day) {
+            headDay++;
+            int old = headDay % WINDOW_TERM_DAYS;              // slot of headDay - ring size, now reused
+            present[old] = 0; total[old] = 0;
+            int leaving = (headDay - WINDOW_RECENT_DAYS) % WINDOW_TERM_DAYS;
+            recentPresent -= present[leaving]; recentTotal -= total[leaving];
+        }
+    }
+
+    void add(int day, int dPresent, int dTotal) {
+        if (day > headDay) advanceTo(day);
+        if (day <= headDay - WINDOW_TERM_DAYS) return; // older than the ring
+        int slot = day % WINDOW_TERM_DAYS;
+        present[slot] = (unsigned short)(present[slot] + dPresent);
+        total[slot] = (unsigned short)(total[slot] + dTotal);
+        if (day >= termFirstDay) { termPresent += dPresent; termTotal += dTotal; }
+        if (day > headDay - WINDOW_RECENT_DAYS) { recentPresent += dPresent; recentTotal += dTotal; }
+    }
+
+    // -1 when there were no classes in the window
+    double recentRate() const { return recentTotal > 0 ? recentPresent * 100.0 / recentTotal : -1; }
+    double termRate() const { return termTotal > 0 ? termPresent * 100.0 / termTotal : -1; }
+};
+
+// All windows for one database (one per campus when sharded)
+struct WindowStore {
+    unordered_map<int, AttendanceWindow> students;
+    bool loaded = false;
+    chrono::steady_clock::time_point loadedAt;
+};
+
+map<string, WindowStore> windowStores;
+
+// Daily present/total per student over the term window; bound with WINDOW_TERM_DAYS - 1
+const string WINDOW_LOAD_SQL = "SELECT StudentID, DATE(AttendanceDate), SUM(Status = 'Present'), COUNT(*) FROM ATTENDANCE WHERE AttendanceDate >= CURDATE() - INTERVAL ? DAY GROUP BY StudentID, DATE(AttendanceDate)";
+
+WindowStore& windowStoreAt(const string& host, const string& schema) {
+    return windowStores[host + "|" + schema];
+}
+
+// The store for conn's database, without loading it
+WindowStore& windowStoreOf(sql::Connection* conn) {
+    string host, schema;
+    targetOf(conn, host, schema);
+    return windowStoreAt(host, schema);
+}
+
+bool windowStoreFresh(const WindowStore& store) {
+    return store.loaded && secondsSince(store.loadedAt) < WINDOW_RELOAD_SEC;
+}
+
+// Refills a store from WINDOW_LOAD_SQL rows (one scatter part)
+void fillWindowStore(WindowStore& store, const QueryResult& r) {
+    store.students.clear();
+    int today = todayNumber();
+    for (size_t i = 0; i < r.size(); i++) {
+        AttendanceWindow& w = store.students[r.integer(i, 0)];
+        if (w.headDay == -1) w.advanceTo(today);
+        w.add(dayNumber(r.text(i, 1)), r.integer(i, 2), r.integer(i, 3));
+    }
+    store.loaded = true;
+    store.loadedAt = chrono::steady_clock::now();
+}
+
+// Called after a roll call is saved. hadRecord/oldStatus describe the row before the save.
+// Only a store loaded before the save takes the change: one that is missing or due for
+// a reload would read the saved rows back from ATTENDANCE and count them twice.
+void recordAttendanceChange(sql::Connection* conn, int studentID, int day, bool hadRecord, const string& oldStatus, const string& newStatus) {
+    WindowStore& store = windowStoreOf(conn);
+    if (!windowStoreFresh(store)) { store.loaded = false; return; } // reloaded on the next read
+    AttendanceWindow& w = store.students[studentID];
+    int dPresent = (newStatus == "Present" ? 1 : 0) - (hadRecord && oldStatus == "Present" ? 1 : 0);
+    int dTotal = hadRecord ? 0 : 1;
+    if (dPresent != 0 || dTotal != 0) w.add(day, dPresent, dTotal);
+}
+
+// For bulk writers (tap ingest) that can't say per student what changed
+void invalidateWindows(sql::Connection* conn) {
+    windowStoreOf(conn).loaded = false;
+}
+
+// ===================== STUDENT SESSION CACHE =====================
+// Everything the student screens show, loaded in the background right after login.
+// The queries run on the query pool (its own connections), so the menu is usable
+// immediately and the first screen opened is usually already loaded.
+enum StudentDataset { DS_PROFILE, DS_ATTENDANCE, DS_ATTENDANCE_MONTHS, DS_ATTENDANCE_WEEKS, DS_UNPAID_FEES, DS_CHECKPOINT, DS_PAYMENTS, DS_SCORE, DS_WINDOW, DS_COUNT };
+
+// First day of the current term in SQL (same rule as termStart())
+const string CURRENT_TERM_SQL = "(MAKEDATE(YEAR(CURDATE()), 1) + INTERVAL ((MONTH(CURDATE()) - 1) DIV " + to_string(TERM_MONTHS) + " * " + to_string(TERM_MONTHS) + ") MONTH)";
+
+// Each query takes the StudentID as its only parameter. Attendance and the score only
+// read the current term, which is always in the hot ATTENDANCE table.
+const string STUDENT_QUERIES[DS_COUNT] = {
+    "SELECT StudentName FROM STUDENT WHERE StudentID = ?",
+    // Attendance: per-course totals, then (period, course) counts for the last 12 months / weeks of the term
+    "SELECT C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE A JOIN COURSE C ON A.CourseID = C.CourseID WHERE A.StudentID=? AND A.AttendanceDate >= " + CURRENT_TERM_SQL + " GROUP BY A.CourseID, C.CourseName ORDER BY C.CourseName",
+    "SELECT DATE_FORMAT(A.AttendanceDate, '%Y-%m-01') AS Period, C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE A JOIN COURSE C ON A.CourseID = C.CourseID "
+        "WHERE A.StudentID=? AND A.AttendanceDate >= DATE_FORMAT(CURDATE() - INTERVAL 11 MONTH, '%Y-%m-01') AND A.AttendanceDate >= " + CURRENT_TERM_SQL + " GROUP BY Period, A.CourseID, C.CourseName ORDER BY Period DESC",
+    "SELECT DATE(A.AttendanceDate) - INTERVAL WEEKDAY(A.AttendanceDate) DAY AS Period, C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE A JOIN COURSE C ON A.CourseID = C.CourseID "
+        "WHERE A.StudentID=? AND A.AttendanceDate >= CURDATE() - INTERVAL WEEKDAY(CURDATE()) DAY - INTERVAL 11 WEEK AND A.AttendanceDate >= " + CURRENT_TERM_SQL + " GROUP BY Period, A.CourseID, C.CourseName ORDER BY Period DESC",
+    "SELECT SF.SFID, F.FeeName, SF.AmountDue, SF.AmountPaid FROM STUDENT_FEE SF JOIN FEE F ON SF.FeeID=F.FeeID WHERE SF.StudentID=? AND SF.Status<>'Paid'",
+    // Statement: the latest balance checkpoint, then only the payments made since it.
+    // The checkpoint can be older than the hot terms, so this one reads PAYMENT_ALL.
+    "SELECT AsOf, TotalDue, TotalPaid, PaymentCount FROM BALANCE_CHECKPOINT WHERE StudentID = ? ORDER BY AsOf DESC LIMIT 1",
+    "SELECT P.TransactionRef, P.Amount, P.PaymentDate, F.FeeName, S.StudentName FROM PAYMENT_ALL P JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID JOIN STUDENT S ON P.StudentID = S.StudentID "
+        "WHERE P.StudentID = ? AND P.PaymentDate >= COALESCE((SELECT MAX(AsOf) FROM BALANCE_CHECKPOINT WHERE StudentID = P.StudentID), '1000-01-01') ORDER BY P.PaymentDate DESC",
+    "SELECT * FROM ( SELECT S.StudentID, S.StudentName, (SUM(CASE WHEN A.Status='Present' THEN 1.0 ELSE 0.0 END) / COUNT(A.AttendanceID)) * 100.0 AS AttRate, (SUM(SF.AmountPaid) / SUM(SF.AmountDue)) * 100.0 AS PayRate FROM STUDENT S JOIN ATTENDANCE A ON S.StudentID = A.StudentID AND A.AttendanceDate >= " + CURRENT_TERM_SQL + " JOIN STUDENT_FEE SF ON S.StudentID = SF.StudentID GROUP BY S.StudentID) AS T WHERE StudentID = ?",
+    // This student's rows of WINDOW_LOAD_SQL, for studentWindow()
+    "SELECT DATE(AttendanceDate), SUM(Status = 'Present'), COUNT(*) FROM ATTENDANCE WHERE StudentID = ? AND AttendanceDate >= CURDATE() - INTERVAL " + to_string(WINDOW_TERM_DAYS - 1) + " DAY GROUP BY DATE(AttendanceDate)"
+};
+
+// The same datasets with history included ("" where there is nothing older to add).
+// Loaded only when the student asks for them, never prefetched.
+const string STUDENT_HISTORY_QUERIES[DS_COUNT] = {
+    "",
+    "SELECT C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE_ALL A JOIN COURSE C ON A.CourseID = C.CourseID WHERE A.StudentID=? GROUP BY A.CourseID, C.CourseName ORDER BY C.CourseName",
+    "SELECT DATE_FORMAT(A.AttendanceDate, '%Y-%m-01') AS Period, C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE_ALL A JOIN COURSE C ON A.CourseID = C.CourseID "
+        "WHERE A.StudentID=? AND A.AttendanceDate >= DATE_FORMAT(CURDATE() - INTERVAL 11 MONTH, '%Y-%m-01') GROUP BY Period, A.CourseID, C.CourseName ORDER BY Period DESC",
+    "SELECT DATE(A.AttendanceDate) - INTERVAL WEEKDAY(A.AttendanceDate) DAY AS Period, C.CourseName, SUM(A.Status = 'Present'), SUM(A.Status = 'Absent'), SUM(A.Status = 'Late') FROM ATTENDANCE_ALL A JOIN COURSE C ON A.CourseID = C.CourseID "
+        "WHERE A.StudentID=? AND A.AttendanceDate >= CURDATE() - INTERVAL WEEKDAY(CURDATE()) DAY - INTERVAL 11 WEEK GROUP BY Period, A.CourseID, C.CourseName ORDER BY Period DESC",
+    "",
+    "",
+    "",
+    "SELECT * FROM ( SELECT S.StudentID, S.StudentName, (SUM(CASE WHEN A.Status='Present' THEN 1.0 ELSE 0.0 END) / COUNT(A.AttendanceID)) * 100.0 AS AttRate, (SUM(SF.AmountPaid) / SUM(SF.AmountDue)) * 100.0 AS PayRate FROM STUDENT S JOIN ATTENDANCE_ALL A ON S.StudentID = A.StudentID JOIN STUDENT_FEE SF ON S.StudentID = SF.StudentID GROUP BY S.StudentID) AS T WHERE StudentID = ?",
+    ""
+};
+
+// Lives for one student login. The student's own writes call refresh() for the
+// datasets they change, which reloads them in the background.
+class StudentCache {
+public:
+    StudentCache(sql::Connection* conn, int studentID) : conn(conn), sid(studentID) {}
+
+    int studentID() const { return sid; }
+
+    void prefetchAll() { for (int ds = 0; ds < DS_COUNT; ds++) refresh(ds); }
+
+    void refresh(int ds) {
+        hasData[ds] = false;
+        pending[ds] = queryPoolFor(conn).submit(STUDENT_QUERIES[ds], { to_string(sid) });
+    }
+
+    // Waits for the background load if it is still running. Errors are not cached.
+    QueryResult get(int ds) {
+        if (!hasData[ds]) {
+            if (!pending[ds].valid()) refresh(ds);
+            data[ds] = pending[ds].get();
+            hasData[ds] = data[ds].ok();
+        }
+        return data[ds];
+    }
+
+private:
+    sql::Connection* conn;
+    int sid;
+    future<QueryResult> pending[DS_COUNT];
+    QueryResult data[DS_COUNT];
+    bool hasData[DS_COUNT] = {};
+};
+
+// One student dataset, from the cache if the screen has one, otherwise loaded now.
+// With history the query also reads the history tables, and always runs now.
+QueryResult loadStudentData(sql::Connection* conn, int studentID, int ds, StudentCache* cache, bool history = false) {
+    if (history && !STUDENT_HISTORY_QUERIES[ds].empty()) return queryPoolFor(conn).submit(STUDENT_HISTORY_QUERIES[ds], { to_string(studentID) }).get();
+    if (cache) return cache->get(ds);
+    return queryPoolFor(conn).submit(STUDENT_QUERIES[ds], { to_string(studentID) }).get();
+}
+
+// One student's window, moved forward to today. Built from that student's rows only,
+// so the score screen never loads the whole campus store.
+AttendanceWindow studentWindow(sql::Connection* conn, int studentID, StudentCache* cache) {
+    QueryResult r = loadStudentData(conn, studentID, DS_WINDOW, cache);
+    if (!r.ok()) throw sql::SQLException(r.error);
+    AttendanceWindow w;
+    w.advanceTo(todayNumber());
+    for (size_t i = 0; i < r.size(); i++) w.add(dayNumber(r.text(i, 0)), r.integer(i, 1), r.integer(i, 2));
+    return w;
+}
+
+// ===================== TEACHER DAY ROSTER =====================
+// Every section a teacher takes, with each student's status for today, read in one
+// query when the teacher logs in. Roll calls edit this copy, and Save writes the
+// changes for all sections in one transaction, so switching sections never goes
+// back to the database.
+const string ROSTER_QUERY =
+    "SELECT C.CourseID, C.CourseName, S.StudentID, S.StudentName, A.Status FROM COURSE C "
+    "LEFT JOIN STUDENT_COURSE SC ON SC.CourseID = C.CourseID LEFT JOIN STUDENT S ON S.StudentID = SC.StudentID "
+    "LEFT JOIN ATTENDANCE A ON A.StudentID = SC.StudentID AND A.CourseID = C.CourseID AND A.AttendanceDate >= CURDATE() AND A.AttendanceDate < CURDATE() + INTERVAL 1 DAY "
+    "WHERE C.Lecturer_ID = ? ORDER BY C.CourseName, C.CourseID, S.StudentName, S.StudentID";
+
+struct RosterEntry {
+    int studentID;
+    string name;
+    string status;      // what the roll call shows
+    string savedStatus; // what the database has, "" if there is no row for today yet
+};
+
+struct RosterSection {
+    int courseID;
+    string courseName;
+    vector<RosterEntry> students;
+    bool opened = false; // only sections the teacher has looked at get saved
+};
+
+// Lives for one teacher login
+class TeacherRoster {
+public:
+    TeacherRoster(sql::Connection* conn, int teacherID) : conn(conn), tid(teacherID) {}
+
+    // Starts loading in the background; the other calls wait for it
+    void load() {
+        pending = queryPoolFor(conn).submit(ROSTER_QUERY, { to_string(tid) });
+        loadedDay = todayNumber();
+        loaded = false;
+    }
+
+    int day() const { return loadedDay; }
+    string error() { wait(); return loadError; }
+    vector<RosterSection>& sections() { wait(); return data; }
+
+    // Edits in opened sections that are not in the database yet
+    int unsaved() {
+        wait();
+        int n = 0;
+        for (const RosterSection& s : data) {
+            if (!s.opened) continue;
+            for (const RosterEntry& e : s.students) if (e.status != e.savedStatus) n++;
+        }
+        return n;
+    }
+
+    // Writes every opened section's edits together. Returns "" or the error.
+    string save() {
+        wait();
+        if (todayNumber() != loadedDay) return "The day has changed since the roster was loaded. Reload it first.";
+
+        // Today's rows another PC added since the load, (StudentID, CourseID) -> Status.
+        // Those students are updated like any existing row instead of being inserted.
+        map<pair<int, int>, string> added;
+        string statuses[3] = { "Present", "Absent", "Late" };
+        try {
+            conn->setAutoCommit(false);
+            vector<int> unseen; // StudentID, CourseID pairs with no row at load time
+            for (const RosterSection& s : data) {
+                if (!s.opened) continue;
+                for (const RosterEntry& e : s.students) if (e.savedStatus.empty()) { unseen.push_back(e.studentID); unseen.push_back(s.courseID); }
+            }
+            if (!unseen.empty()) {
+                // The lock also keeps other PCs from adding today's rows until we commit
+                string pairs;
+                for (size_t i = 0; i < unseen.size(); i += 2) pairs += (i ? ",(?,?)" : "(?,?)");
+                sql::PreparedStatement* q = conn->prepareStatement("SELECT StudentID, CourseID, Status FROM ATTENDANCE WHERE AttendanceDate >= CURDATE() AND AttendanceDate < CURDATE() + INTERVAL 1 DAY AND (StudentID, CourseID) IN (" + pairs + ") FOR UPDATE");
+                for (size_t i = 0; i < unseen.size(); i++) q->setInt((unsigned int)i + 1, unseen[i]);
+                sql::ResultSet* r = q->executeQuery();
+                while (r->next()) added[{ r->getInt(1), r->getInt(2) }] = r->getString(3);
+                delete r; delete q;
+            }
+
+            vector<string> newRows; // StudentID, CourseID, Status for students with no row yet
+            for (const RosterSection& s : data) {
+                if (!s.opened) continue;
+                // Rows that exist: one UPDATE per section and status
+                for (const string& st : statuses) {
+                    vector<int> ids;
+                    for (const RosterEntry& e : s.students) {
+                        if (e.status == st && e.status != e.savedStatus && (!e.savedStatus.empty() || added.count({ e.studentID, s.courseID }))) ids.push_back(e.studentID);
+                    }
+                    if (ids.empty()) continue;
+                    string marks;
+                    for (size_t i = 0; i < ids.size(); i++) marks += (i ? ",?" : "?");
+                    sql::PreparedStatement* upd = conn->prepareStatement("UPDATE ATTENDANCE SET Status=? WHERE CourseID=? AND AttendanceDate >= CURDATE() AND AttendanceDate < CURDATE() + INTERVAL 1 DAY AND StudentID IN (" + marks + ")");
+                    upd->setString(1, st); upd->setInt(2, s.courseID);
+                    for (size_t i = 0; i < ids.size(); i++) upd->setInt((unsigned int)i + 3, ids[i]);
+                    upd->executeUpdate();
+                    delete upd;
+                }
+                for (const RosterEntry& e : s.students) {
+                    if (e.savedStatus.empty() && !added.count({ e.studentID, s.courseID })) { newRows.push_back(to_string(e.studentID)); newRows.push_back(to_string(s.courseID)); newRows.push_back(e.status); }
+                }
+            }
+            // Rows that don't: one INSERT for all sections. The NOT EXISTS is a last guard;
+            // if it skipped anyone the save is refused rather than dropping their status.
+            if (!newRows.empty()) {
+                string values;
+                for (size_t i = 0; i < newRows.size(); i += 3) values += (i ? " UNION ALL SELECT ?, ?, ?" : "SELECT ? AS StudentID, ? AS CourseID, ? AS Status");
+                sql::PreparedStatement* ins = conn->prepareStatement("INSERT INTO ATTENDANCE (StudentID, CourseID, AttendanceDate, Status) SELECT V.StudentID, V.CourseID, CURDATE(), V.Status FROM (" + values + ") V "
+                    "WHERE NOT EXISTS (SELECT 1 FROM ATTENDANCE A WHERE A.StudentID = V.StudentID AND A.CourseID = V.CourseID AND A.AttendanceDate >= CURDATE() AND A.AttendanceDate < CURDATE() + INTERVAL 1 DAY)");
+                for (size_t i = 0; i < newRows.size(); i++) ins->setString((unsigned int)i + 1, newRows[i]);
+                int inserted = ins->executeUpdate();
+                delete ins;
+                if (inserted != (int)(newRows.size() / 3)) {
+                    conn->rollback(); conn->setAutoCommit(true);
+                    return "Another PC saved part of this roll call meanwhile. Reload it and save again.";
+                }
+            }
+            conn->commit();
+            conn->setAutoCommit(true);
+        }
+        catch (sql::SQLException& e) {
+            try { conn->rollback(); } catch (...) {}
+            conn->setAutoCommit(true);
+            return e.what();
+        }
+
+        // Keep the 4-week / term windows current without reloading them. A row another
+        // PC added counts as one that existed, with that PC's status.
+        uint64_t logged = 0;
+        for (RosterSection& s : data) {
+            if (!s.opened) continue;
+            for (RosterEntry& e : s.students) {
+                if (e.status == e.savedStatus) continue;
+                auto other = added.find({ e.studentID, s.courseID });
+                bool hadRecord = !e.savedStatus.empty() || other != added.end();
+                string oldStatus = other != added.end() ? other->second : e.savedStatus;
+                e.savedStatus = e.status;
+                if (hadRecord && oldStatus == e.status) continue; // the database already had it
+                recordAttendanceChange(conn, e.studentID, loadedDay, hadRecord, oldStatus, e.status);
+                ChangeEvent ev;
+                ev.type = EV_ATTENDANCE; ev.key1 = e.studentID; ev.key2 = s.courseID; ev.text = dateOfDay(loadedDay) + " " + e.status;
+                logged = changeLog.append(ev);
+            }
+        }
+        changeLog.waitDurable(logged); // one fsync for the whole roll call
+        bumpTables({ "ATTENDANCE" });
+        return "";
+    }
+
+private:
+    void wait() {
+        if (loaded) return;
+        if (!pending.valid()) load();
+        QueryResult r = pending.get();
+        loaded = true;
+        loadError = r.error;
+        data.clear();
+        // Rows come sorted by section; a section with nobody enrolled has one row with no student
+        for (size_t i = 0; i < r.size(); i++) {
+            int cid = r.integer(i, 0);
+            if (data.empty() || data.back().courseID != cid) data.push_back({ cid, r.text(i, 1), {} });
+            if (r.text(i, 2).empty()) continue;
+            int sid = r.integer(i, 2);
+            vector<RosterEntry>& roll = data.back().students;
+            if (!roll.empty() && roll.back().studentID == sid) continue; // two rows for today; the first one counts
+            string saved = r.text(i, 4);
+            roll.push_back({ sid, r.text(i, 3), saved.empty() ? "Present" : saved, saved });
+        }
+    }
+
+    sql::Connection* conn;
+    int tid;
+    future<QueryResult> pending;
+    bool loaded = false;
+    int loadedDay = -1;
+    string loadError;
+    vector<RosterSection> data;
+};
+
 // ===================== UI FUNCTIONS =====================
 
 void setColor(int color) {
@@ -201,28 +1504,8 @@ void drawMenuFrame(const string& title, string options[], int optionCount, int s
     setColor(8); printCentered("[UP/DOWN] Navigate  [ENTER] Select"); setColor(7);
 }
 
-void drawLoadingScreen(sql::Connection* conn) {
-    system("cls");
-    setColor(10); cout << "\n\n\n";
-    printCentered("STUDENT FEES AND ATTENDANCE MANAGEMENT SYSTEM");
-    setColor(7); cout << "\n\n";
-
-    if (conn && !conn->isClosed()) {
-        setColor(10); printCentered("[SUCCESS] Database Connected Successfully!");
-    }
-    else {
-        setColor(12); printCentered("[ERROR] Database Connection Failed!");
-    }
-
-    setColor(8); cout << "\n\n";
-    printCentered("Press any key to continue...");
-    setColor(7);
-    (void)_getch();
-    system("cls");
-}
-
 // I used ASCII characters to draw the box. 
-void printReceipt(string ref, string date, string sName, string fName, double amount) {
+void printReceipt(string ref, string date, string sName, string fName, Money amount) {
     system("cls");
     cout << "\n\n";
 
@@ -277,7 +1560,7 @@ void printReceipt(string ref, string date, string sName, string fName, double am
     for (int i = 0; i < margin; i++) cout << " ";
     cout << "\xB3 ";
     setColor(10); cout << left << setw(14) << "AMOUNT PAID:";
-    cout << "$ " << left << setw(30) << fixed << setprecision(2) << amount;
+    cout << "$ " << left << setw(30) << amount.toString();
     setColor(11); cout << " \xB3" << endl;
 
     // Bottom Border
@@ -290,48 +1573,292 @@ void printReceipt(string ref, string date, string sName, string fName, double am
     (void)_getch();
 }
 
-sql::Connection* connectDB() {
-    try {
-        sql::mysql::MySQL_Driver* driver = sql::mysql::get_driver_instance();
-        sql::Connection* conn = driver->connect("tcp://127.0.0.1:3306", "root", "1234");
-        conn->setSchema("studentmansys_v2");
-        return conn;
+// Reads simple "key = value" lines. "replica" can be given more than once.
+void loadDBConfig(const string& path) {
+    ifstream in(path);
+    if (!in) return; // no file -> keep defaults
+    string line;
+    while (getline(in, line)) {
+        size_t eq = line.find('=');
+        if (line.empty() || line[0] == '#' || line[0] == ';' || eq == string::npos) continue;
+        string key = line.substr(0, eq), val = line.substr(eq + 1);
+        key.erase(0, key.find_first_not_of(" \t")); key.erase(key.find_last_not_of(" \t\r") + 1);
+        val.erase(0, val.find_first_not_of(" \t")); val.erase(val.find_last_not_of(" \t\r") + 1);
+
+        if (key == "primary") dbConfig.primaryHost = val;
+        else if (key == "user") dbConfig.user = val;
+        else if (key == "password") dbConfig.password = val;
+        else if (key == "schema") dbConfig.schema = val;
+        else if (key == "max_replica_lag") dbConfig.maxReplicaLagSec = atoi(val.c_str());
+        else if (key == "replica" && dbConfig.replicaCount < MAX_REPLICAS) dbConfig.replicaHosts[dbConfig.replicaCount++] = val;
+        else if (key == "shard" && dbConfig.shardCount < MAX_SHARDS) {
+            // shard = <campus name>, <host>, <schema>
+            size_t c1 = val.find(','), c2 = val.find(',', c1 == string::npos ? c1 : c1 + 1);
+            if (c1 == string::npos || c2 == string::npos) continue;
+            string parts[3] = { val.substr(0, c1), val.substr(c1 + 1, c2 - c1 - 1), val.substr(c2 + 1) };
+            for (string& p : parts) { p.erase(0, p.find_first_not_of(" \t")); p.erase(p.find_last_not_of(" \t") + 1); }
+            int n = dbConfig.shardCount++;
+            dbConfig.shardNames[n] = parts[0]; dbConfig.shardHosts[n] = parts[1]; dbConfig.shardSchemas[n] = parts[2];
+        }
     }
-    catch (sql::SQLException& e) {
-        drawError("Database connection failed: " + string(e.what()));
-        (void)_getch();
-        exit(1);
+}
+
+// Throws sql::SQLException if the server can't be reached
+sql::Connection* openConnection(const string& host, const string& schema) {
+    sql::mysql::MySQL_Driver* driver = sql::mysql::get_driver_instance();
+    sql::Connection* conn = driver->connect(host, dbConfig.user, dbConfig.password);
+    conn->setSchema(schema.empty() ? dbConfig.schema : schema);
+    return conn;
+}
+
+// The main-thread connection to one campus, opened on first use. nullptr if it is down.
+sql::Connection* shardConnection(int shard) {
+    if (shard < 0 || shard >= dbConfig.shardCount) return nullptr;
+    if (shardConns[shard] && shardConns[shard]->isValid()) return shardConns[shard];
+    delete shardConns[shard]; shardConns[shard] = nullptr;
+    try { shardConns[shard] = openConnection(dbConfig.shardHosts[shard], dbConfig.shardSchemas[shard]); }
+    catch (sql::SQLException& e) { drawError("Campus " + dbConfig.shardNames[shard] + " unavailable: " + string(e.what())); }
+    return shardConns[shard];
+}
+
+// Lets the admin pick which campus to manage. Returns -1 on Back.
+int chooseCampus() {
+    string ops[MAX_SHARDS + 1];
+    for (int i = 0; i < dbConfig.shardCount; i++) ops[i] = dbConfig.shardNames[i];
+    ops[dbConfig.shardCount] = "Back";
+    int opCount = dbConfig.shardCount + 1;
+    int choice = 0;
+    system("cls");
+    while (true) {
+        drawMenuFrame("SELECT CAMPUS", ops, opCount, choice);
+        char key = (char)_getch();
+        if (key == 72) choice = (choice - 1 + opCount) % opCount;
+        else if (key == 80) choice = (choice + 1) % opCount;
+        else if (key == 13) break;
     }
+    return (choice == opCount - 1) ? -1 : choice;
 }
 
-int getStudentID(sql::Connection* conn, string username) {
+// Asks the replica how far behind the primary it is. A server that is not
+// replicating at all (e.g. a second local mysqld used for testing) counts as 0 lag.
+bool checkReplica(ReplicaState& rep) {
+    rep.lastCheck = chrono::steady_clock::now();
+    rep.healthy = false;
     try {
-        sql::PreparedStatement* p = conn->prepareStatement("SELECT StudentID FROM STUDENT WHERE Username = ?");
-        p->setString(1, username);
-        sql::ResultSet* r = p->executeQuery();
-        int sid = -1;
-        if (r->next()) sid = r->getInt("StudentID");
-        delete r; delete p;
-        return sid;
+        sql::Statement* s = rep.conn->createStatement();
+        sql::ResultSet* r = nullptr;
+        string lagCol = "Seconds_Behind_Source";
+        try { r = s->executeQuery("SHOW REPLICA STATUS"); }
+        catch (sql::SQLException&) { r = s->executeQuery("SHOW SLAVE STATUS"); lagCol = "Seconds_Behind_Master"; } // MySQL < 8.0.22
+        if (!r->next()) rep.lagSec = 0;
+        else if (r->isNull(lagCol)) rep.lagSec = -1; // replication thread stopped
+        else rep.lagSec = r->getInt(lagCol);
+        delete r; delete s;
+        rep.healthy = (rep.lagSec >= 0 && rep.lagSec <= dbConfig.maxReplicaLagSec);
     }
-    catch (sql::SQLException&) { return -1; }
+    catch (sql::SQLException&) {
+        delete rep.conn; rep.conn = nullptr; // reconnect on the next check
+    }
+    return rep.healthy;
 }
 
-void listRecords(sql::Connection* conn) {
-    system("cls");
-    while (true) {
-        string ops[] = {
-            "View All Students", "View All Teachers", "View All Courses", "View All Transactions", "Back"
-        };
-        int opCount = 5;
-        int choice = 0;
+// Returns a connection for read-only reports. Uses the replicas round robin and
+// falls back to the primary when none is reachable and fresh enough.
+// Replicas belong to the primary, so with campus shards this just returns primary.
+sql::Connection* readConnection(sql::Connection* primary) {
+    if (dbConfig.shardCount > 0) return primary;
+    const int RECHECK_SEC = 2;    // how long a lag check is trusted
+    const int RETRY_DOWN_SEC = 30; // wait before reconnecting to a dead replica
+    for (int n = 0; n < dbConfig.replicaCount; n++) {
+        int i = (nextReplica + n) % dbConfig.replicaCount;
+        ReplicaState& rep = replicas[i];
+        double age = secondsSince(rep.lastCheck);
+
+        if (!rep.conn) {
+            if (rep.lastCheck.time_since_epoch().count() != 0 && age < RETRY_DOWN_SEC) continue;
+            try { rep.conn = openConnection(dbConfig.replicaHosts[i]); }
+            catch (sql::SQLException&) { rep.lastCheck = chrono::steady_clock::now(); rep.healthy = false; continue; }
+            checkReplica(rep);
+        }
+        else if (age >= RECHECK_SEC) checkReplica(rep);
 
-        while (true) {
-            drawMenuFrame("VIEW RECORDS", ops, opCount, choice);
-            char key = (char)_getch();
-            if (key == 72) choice = (choice - 1 + opCount) % opCount;
-            else if (key == 80) choice = (choice + 1) % opCount;
-            else if (key == 13) break;
+        if (rep.conn && rep.healthy) {
+            nextReplica = (i + 1) % dbConfig.replicaCount;
+            return rep.conn;
+        }
+    }
+    return primary;
+}
+
+// Which server and schema a connection from connectDB()/readConnection()/shardConnection() points at
+void targetOf(sql::Connection* conn, string& outHost, string& outSchema) {
+    outHost = dbConfig.primaryHost; outSchema = dbConfig.schema;
+    for (int i = 0; i < dbConfig.replicaCount; i++) {
+        if (replicas[i].conn == conn) outHost = dbConfig.replicaHosts[i];
+    }
+    for (int i = 0; i < dbConfig.shardCount; i++) {
+        if (shardConns[i] == conn) { outHost = dbConfig.shardHosts[i]; outSchema = dbConfig.shardSchemas[i]; }
+    }
+}
+
+void closeReplicas() {
+    for (int i = 0; i < MAX_REPLICAS; i++) { delete replicas[i].conn; replicas[i].conn = nullptr; }
+    for (int i = 0; i < MAX_SHARDS; i++) { delete shardConns[i]; shardConns[i] = nullptr; }
+}
+
+bool tableExists(sql::Connection* conn, const string& table) {
+    sql::PreparedStatement* p = conn->prepareStatement("SELECT COUNT(*) FROM INFORMATION_SCHEMA.TABLES WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ?");
+    p->setString(1, table);
+    sql::ResultSet* r = p->executeQuery();
+    bool found = (r->next() && r->getInt(1) > 0);
+    delete r; delete p;
+    return found;
+}
+
+bool columnExists(sql::Connection* conn, const string& table, const string& column) {
+    sql::PreparedStatement* p = conn->prepareStatement("SELECT COUNT(*) FROM INFORMATION_SCHEMA.COLUMNS WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND COLUMN_NAME = ?");
+    p->setString(1, table); p->setString(2, column);
+    sql::ResultSet* r = p->executeQuery();
+    bool found = (r->next() && r->getInt(1) > 0);
+    delete r; delete p;
+    return found;
+}
+
+bool indexExists(sql::Connection* conn, const string& table, const string& index) {
+    sql::PreparedStatement* p = conn->prepareStatement("SELECT COUNT(*) FROM INFORMATION_SCHEMA.STATISTICS WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND INDEX_NAME = ?");
+    p->setString(1, table); p->setString(2, index);
+    sql::ResultSet* r = p->executeQuery();
+    bool found = (r->next() && r->getInt(1) > 0);
+    delete r; delete p;
+    return found;
+}
+
+// Adds the extra columns/tables newer features need. Safe to run every startup.
+// Returns "" when everything is in place, otherwise the error. Prints nothing, since
+// it runs on the startup thread while the menu is on screen.
+string ensureSchema(sql::Connection* conn) {
+    try {
+        sql::Statement* s = conn->createStatement();
+
+        // Link each fee to the course it belongs to (NULL for library/lab style fees)
+        if (!columnExists(conn, "FEE", "CourseID")) {
+            s->execute("ALTER TABLE FEE ADD COLUMN CourseID INT NULL, ADD INDEX idx_fee_course (CourseID)");
+            // Old tuition fees were only linked by name
+            s->executeUpdate("UPDATE FEE F JOIN COURSE C ON F.FeeName = CONCAT('Tuition: ', C.CourseName) SET F.CourseID = C.CourseID WHERE F.IsTuition = 1");
+        }
+
+        // Billing runs look up (StudentID, FeeID) to skip students already billed
+        if (!indexExists(conn, "STUDENT_FEE", "idx_sf_student_fee")) {
+            s->execute("ALTER TABLE STUDENT_FEE ADD INDEX idx_sf_student_fee (StudentID, FeeID)");
+        }
+
+        // Attendance lookups by student/course/day (roll call, tap ingest)
+        if (!indexExists(conn, "ATTENDANCE", "idx_att_student_course_date")) {
+            s->execute("ALTER TABLE ATTENDANCE ADD INDEX idx_att_student_course_date (StudentID, CourseID, AttendanceDate)");
+        }
+
+        // Seat reservation: capacity (NULL = unlimited), the seat counter and the waitlist
+        if (!columnExists(conn, "COURSE", "SeatsTaken")) {
+            s->execute("ALTER TABLE COURSE ADD COLUMN Capacity INT NULL, ADD COLUMN SeatsTaken INT NOT NULL DEFAULT 0");
+            s->execute("UPDATE COURSE C SET SeatsTaken = (SELECT COUNT(*) FROM STUDENT_COURSE SC WHERE SC.CourseID = C.CourseID)");
+        }
+        s->execute("CREATE TABLE IF NOT EXISTS WAITLIST (WaitID INT AUTO_INCREMENT PRIMARY KEY, CourseID INT NOT NULL, StudentID INT NOT NULL, CreatedAt TIMESTAMP DEFAULT CURRENT_TIMESTAMP, UNIQUE KEY uq_wait_course_student (CourseID, StudentID))");
+
+        // Term rollover checks (StudentID, CourseID) before enrolling
+        if (!indexExists(conn, "STUDENT_COURSE", "idx_sc_student_course")) {
+            s->execute("ALTER TABLE STUDENT_COURSE ADD INDEX idx_sc_student_course (StudentID, CourseID)");
+        }
+
+        // Fee changes update every unpaid bill for a fee
+        if (!indexExists(conn, "STUDENT_FEE", "idx_sf_fee_status")) {
+            s->execute("ALTER TABLE STUDENT_FEE ADD INDEX idx_sf_fee_status (FeeID, Status)");
+        }
+
+        // One row per course, kept up to date by payFees()
+        bool newRevenueTable = !tableExists(conn, "COURSE_REVENUE");
+        s->execute("CREATE TABLE IF NOT EXISTS COURSE_REVENUE (CourseID INT PRIMARY KEY, TotalCollected DECIMAL(14,2) NOT NULL DEFAULT 0, PaymentCount INT NOT NULL DEFAULT 0)");
+
+        // Per-term balance checkpoints written by payFees(), and the index that
+        // reads "payments since the checkpoint" for one student
+        s->execute("CREATE TABLE IF NOT EXISTS BALANCE_CHECKPOINT (StudentID INT NOT NULL, AsOf DATE NOT NULL, TotalDue DECIMAL(14,2) NOT NULL, TotalPaid DECIMAL(14,2) NOT NULL, PaymentCount INT NOT NULL, PRIMARY KEY (StudentID, AsOf))");
+        if (!indexExists(conn, "PAYMENT", "idx_pay_student_date")) {
+            s->execute("ALTER TABLE PAYMENT ADD INDEX idx_pay_student_date (StudentID, PaymentDate)");
+        }
+
+        // Debt aging: when each fee was billed, per-student buckets and the date of the
+        // last daily sweep. Existing fees count as billed when the column is added.
+        if (!columnExists(conn, "STUDENT_FEE", "BilledAt")) {
+            s->execute("ALTER TABLE STUDENT_FEE ADD COLUMN BilledAt DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP, ADD INDEX idx_sf_billed (BilledAt)");
+        }
+        if (tableExists(conn, "STUDENT_FEE_ARCHIVE") && !columnExists(conn, "STUDENT_FEE_ARCHIVE", "BilledAt")) {
+            s->execute("ALTER TABLE STUDENT_FEE_ARCHIVE ADD COLUMN BilledAt DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP"); // archiving copies with SELECT *
+        }
+        // Checkpoint TotalDue used to be everything billed by the term's first payment; it is
+        // now only what was billed before AsOf. DueBeforeAsOf marks checkpoints already converted.
+        if (!columnExists(conn, "BALANCE_CHECKPOINT", "DueBeforeAsOf")) {
+            s->execute("UPDATE BALANCE_CHECKPOINT B SET TotalDue = (SELECT COALESCE(SUM(F.AmountDue), 0) FROM STUDENT_FEE F WHERE F.StudentID = B.StudentID AND F.BilledAt < B.AsOf)");
+            s->execute("ALTER TABLE BALANCE_CHECKPOINT ADD COLUMN DueBeforeAsOf TINYINT NOT NULL DEFAULT 1");
+        }
+        if (tableExists(conn, "BALANCE_CHECKPOINT_ARCHIVE") && !columnExists(conn, "BALANCE_CHECKPOINT_ARCHIVE", "DueBeforeAsOf")) {
+            s->execute("ALTER TABLE BALANCE_CHECKPOINT_ARCHIVE ADD COLUMN DueBeforeAsOf TINYINT NOT NULL DEFAULT 1");
+        }
+        s->execute("CREATE TABLE IF NOT EXISTS DEBT_AGING (StudentID INT PRIMARY KEY, Days0_30 DECIMAL(14,2) NOT NULL, Days31_60 DECIMAL(14,2) NOT NULL, Days61_90 DECIMAL(14,2) NOT NULL, Days90Plus DECIMAL(14,2) NOT NULL)");
+        s->execute("CREATE TABLE IF NOT EXISTS AGING_STATE (ID INT PRIMARY KEY, LastSweep DATE NULL)");
+        s->execute("DROP TABLE IF EXISTS AGING_TOTAL"); // campus totals are now summed from DEBT_AGING
+        s->execute("INSERT IGNORE INTO AGING_STATE (ID, LastSweep) VALUES (1, NULL)");
+
+        // Term tiering: closed terms of ATTENDANCE / PAYMENT move into these compressed,
+        // per-term partitioned tables (see tierClosedTerms), and the *_ALL views read both
+        if (!indexExists(conn, "ATTENDANCE", "idx_att_date")) {
+            s->execute("ALTER TABLE ATTENDANCE ADD INDEX idx_att_date (AttendanceDate)");
+        }
+        if (!indexExists(conn, "PAYMENT", "idx_pay_date")) {
+            s->execute("ALTER TABLE PAYMENT ADD INDEX idx_pay_date (PaymentDate)");
+        }
+        s->execute("CREATE TABLE IF NOT EXISTS ATTENDANCE_HISTORY (AttendanceID INT NOT NULL, StudentID INT NOT NULL, CourseID INT NOT NULL, AttendanceDate DATETIME NOT NULL, Status VARCHAR(10) NOT NULL, "
+            "INDEX idx_atth_student_course_date (StudentID, CourseID, AttendanceDate)) ROW_FORMAT=COMPRESSED KEY_BLOCK_SIZE=8 "
+            "PARTITION BY RANGE COLUMNS(AttendanceDate) (PARTITION p_open VALUES LESS THAN (MAXVALUE))");
+        s->execute("CREATE TABLE IF NOT EXISTS PAYMENT_HISTORY (StudentID INT NOT NULL, SFID INT NOT NULL, Amount DECIMAL(14,2) NOT NULL, PaymentDate DATETIME NOT NULL, TransactionRef VARCHAR(50) NOT NULL, "
+            "INDEX idx_payh_student_date (StudentID, PaymentDate), INDEX idx_payh_sfid (SFID)) ROW_FORMAT=COMPRESSED KEY_BLOCK_SIZE=8 "
+            "PARTITION BY RANGE COLUMNS(PaymentDate) (PARTITION p_open VALUES LESS THAN (MAXVALUE))");
+        s->execute("CREATE OR REPLACE VIEW ATTENDANCE_ALL AS SELECT AttendanceID, StudentID, CourseID, AttendanceDate, Status FROM ATTENDANCE UNION ALL SELECT AttendanceID, StudentID, CourseID, AttendanceDate, Status FROM ATTENDANCE_HISTORY");
+        s->execute("CREATE OR REPLACE VIEW PAYMENT_ALL AS SELECT StudentID, SFID, Amount, PaymentDate, TransactionRef FROM PAYMENT UNION ALL SELECT StudentID, SFID, Amount, PaymentDate, TransactionRef FROM PAYMENT_HISTORY");
+        delete s;
+
+        if (newRevenueTable) rebuildCourseRevenue(conn, false);
+    }
+    catch (sql::SQLException& e) { return e.what(); }
+    return "";
+}
+
+int getStudentID(sql::Connection* conn, string username) {
+    try {
+        sql::PreparedStatement* p = conn->prepareStatement("SELECT StudentID FROM STUDENT WHERE Username = ?");
+        p->setString(1, username);
+        sql::ResultSet* r = p->executeQuery();
+        int sid = -1;
+        if (r->next()) sid = r->getInt("StudentID");
+        delete r; delete p;
+        return sid;
+    }
+    catch (sql::SQLException&) { return -1; }
+}
+
+void listRecords(sql::Connection* conn) {
+    system("cls");
+    while (true) {
+        string ops[] = {
+            "View All Students", "View All Teachers", "View All Courses", "View All Transactions", "Back"
+        };
+        int opCount = 5;
+        int choice = 0;
+
+        while (true) {
+            drawMenuFrame("VIEW RECORDS", ops, opCount, choice);
+            char key = (char)_getch();
+            if (key == 72) choice = (choice - 1 + opCount) % opCount;
+            else if (key == 80) choice = (choice + 1) % opCount;
+            else if (key == 13) break;
         }
 
         if (choice == 4) return;
@@ -340,13 +1867,13 @@ void listRecords(sql::Connection* conn) {
         // Transaction History Logic
         if (choice == 3) {
             drawHeader("TRANSACTION HISTORY", 11);
-            string query = "SELECT P.TransactionRef, P.Amount, P.PaymentDate, S.StudentName, F.FeeName FROM PAYMENT P JOIN STUDENT S ON P.StudentID = S.StudentID JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID ORDER BY P.PaymentDate DESC";
+            string query = "SELECT P.TransactionRef, P.Amount, P.PaymentDate, S.StudentName, F.FeeName FROM PAYMENT_ALL P JOIN STUDENT S ON P.StudentID = S.StudentID JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID ORDER BY P.PaymentDate DESC";
 
             try {
                 sql::Statement* stmt = conn->createStatement();
                 sql::ResultSet* r = stmt->executeQuery(query);
 
-                struct TransData { string ref; double amt; string date; string sName; string fName; };
+                struct TransData { string ref; Money amt; string date; string sName; string fName; };
                 TransData history[MAX_ITEMS];
                 int count = 0;
 
@@ -357,12 +1884,12 @@ void listRecords(sql::Connection* conn) {
                 while (r->next()) {
                     if (count >= MAX_ITEMS) break; // Safety check
                     history[count].ref = r->getString("TransactionRef");
-                    history[count].amt = r->getDouble("Amount");
+                    history[count].amt = Money::fromColumn(r->getString("Amount"));
                     history[count].date = r->getString("PaymentDate");
                     history[count].sName = r->getString("StudentName");
                     history[count].fName = r->getString("FeeName");
 
-                    cout << left << setw(5) << row++ << setw(20) << history[count].ref << "$" << setw(14) << fixed << setprecision(2) << history[count].amt << setw(20) << history[count].sName.substr(0, 18) << history[count].date << endl;
+                    cout << left << setw(5) << row++ << setw(20) << history[count].ref << "$" << setw(14) << history[count].amt.toString() << setw(20) << history[count].sName.substr(0, 18) << history[count].date << endl;
                     count++;
                 }
                 delete r; delete stmt;
@@ -387,45 +1914,45 @@ void listRecords(sql::Connection* conn) {
             continue;
         }
 
+        // These lists only change when an account or course is written, so they come from the result cache
         string query;
+        vector<string> tables;
         if (choice == 0) {
             drawHeader("LIST OF STUDENTS", 11);
             query = "SELECT StudentID, StudentName, Username, Email FROM STUDENT ORDER BY StudentID ASC";
+            tables = { "STUDENT" };
         }
         else if (choice == 1) {
             drawHeader("LIST OF TEACHERS", 11);
             query = "SELECT TeacherID, TeacherName, Username FROM TEACHER ORDER BY TeacherID ASC";
+            tables = { "TEACHER" };
         }
         else if (choice == 2) {
             drawHeader("LIST OF COURSES", 11);
             query = "SELECT CourseID, CourseName, CreditHours, SemesterFee, (SemesterFee / NULLIF(CreditHours, 0)) as CostPerCredit FROM COURSE ORDER BY CourseID ASC";
+            tables = { "COURSE" };
         }
 
-        try {
-            sql::Statement* stmt = conn->createStatement();
-            sql::ResultSet* r = stmt->executeQuery(query);
-
+        QueryResult r = cachedQuery(conn, query, {}, tables);
+        if (!r.ok()) drawError(r.error);
+        else {
             if (choice == 0) cout << left << setw(5) << "ID" << setw(30) << "Name" << setw(20) << "Username" << "Email" << endl;
             else if (choice == 1) cout << left << setw(5) << "ID" << setw(30) << "Name" << setw(20) << "Username" << endl;
             else if (choice == 2) cout << left << setw(5) << "ID" << setw(30) << "Course" << setw(10) << "Credits" << setw(12) << "Fee($)" << "Value Index" << endl;
 
             cout << string(75, '-') << endl;
 
-            bool found = false;
-            while (r->next()) {
-                found = true;
-                if (choice == 0) cout << left << setw(5) << r->getInt("StudentID") << setw(30) << r->getString("StudentName") << setw(20) << r->getString("Username") << r->getString("Email") << endl;
-                else if (choice == 1) cout << left << setw(5) << r->getInt("TeacherID") << setw(30) << r->getString("TeacherName") << setw(20) << r->getString("Username") << endl;
+            for (size_t row = 0; row < r.size(); row++) {
+                if (choice == 0) cout << left << setw(5) << r.integer(row, 0) << setw(30) << r.text(row, 1) << setw(20) << r.text(row, 2) << r.text(row, 3) << endl;
+                else if (choice == 1) cout << left << setw(5) << r.integer(row, 0) << setw(30) << r.text(row, 1) << setw(20) << r.text(row, 2) << endl;
                 else if (choice == 2) {
-                    double fee = r->getDouble("SemesterFee");
-                    double cpc = r->getDouble("CostPerCredit");
-                    cout << left << setw(5) << r->getInt("CourseID") << setw(30) << r->getString("CourseName") << setw(10) << r->getInt("CreditHours") << "$" << setw(11) << fixed << setprecision(2) << fee << "($" << (int)cpc << "/cr)" << endl;
+                    Money fee = r.money(row, 3);
+                    double cpc = r.num(row, 4);
+                    cout << left << setw(5) << r.integer(row, 0) << setw(30) << r.text(row, 1) << setw(10) << r.integer(row, 2) << "$" << setw(11) << fee.toString() << "($" << (int)cpc << "/cr)" << endl;
                 }
             }
-            if (!found) drawError("No records found.");
-            delete r; delete stmt;
+            if (r.size() == 0) drawError("No records found.");
         }
-        catch (sql::SQLException& e) { drawError(e.what()); }
         cout << "\nPress any key to return..."; (void)_getch();
         system("cls");
     }
@@ -434,195 +1961,2179 @@ void listRecords(sql::Connection* conn) {
 void showAdminStats(sql::Connection* conn) {
     system("cls"); drawHeader("EXECUTIVE ANALYTICS", 13);
 
+    // All five queries are independent, so send them off together (to every campus) and wait once.
+    // I did these separately because JOINing them all at once returned wrong numbers
+    const int QUERY_COUNT = 5;
+    string queries[QUERY_COUNT] = {
+        "SELECT SUM(Amount) AS Total FROM PAYMENT_ALL",
+        "SELECT SUM(AmountDue - AmountPaid) AS Debt FROM STUDENT_FEE",
+        "SELECT COUNT(*) FROM STUDENT",
+        // Reads the COURSE_REVENUE counters that payFees() keeps up to date.
+        // Payments count towards a course only through the fee they paid, so a student
+        // in 3 courses no longer adds their payment to all 3.
+        "SELECT C.CourseName, COALESCE(R.TotalCollected, 0) as Metric FROM COURSE C LEFT JOIN COURSE_REVENUE R ON C.CourseID = R.CourseID",
+        "SELECT C.CourseName, COUNT(SC.StudentID) as Metric FROM COURSE C LEFT JOIN STUDENT_COURSE SC ON C.CourseID = SC.CourseID GROUP BY C.CourseID, C.CourseName"
+    };
+    vector<PendingShard> pending[QUERY_COUNT];
+    for (int q = 0; q < QUERY_COUNT - 1; q++) pending[q] = scatterSubmit(conn, queries[q]);
+    vector<ShardResult> parts[QUERY_COUNT];
+    // The enrollment chart only moves when someone enrolls or a course changes, so it comes from the result cache
+    parts[QUERY_COUNT - 1] = cachedScatter(conn, queries[QUERY_COUNT - 1], { "COURSE", "STUDENT_COURSE" });
+    for (int q = 0; q < QUERY_COUNT - 1; q++) parts[q] = scatterWait(pending[q]);
+    for (int q = 0; q < QUERY_COUNT; q++) {
+        string err = scatterError(parts[q]);
+        if (!err.empty()) { drawError(err); cout << "\n\nPress any key..."; (void)_getch(); return; }
+    }
+
+    // Merge the campus partials: totals are summed, courses with the same name are combined
+    vector<int64_t> revParts, debtParts;
+    int totalStu = 0;
+    map<string, Money> revByCourse;
+    map<string, int> popByCourse;
+    for (size_t i = 0; i < parts[0].size(); i++) {
+        revParts.push_back(parts[0][i].result.money(0, 0).cents);
+        debtParts.push_back(parts[1][i].result.money(0, 0).cents);
+        totalStu += parts[2][i].result.integer(0, 0);
+        const QueryResult& rev = parts[3][i].result;
+        for (size_t row = 0; row < rev.size(); row++) revByCourse[rev.text(row, 0)] += rev.money(row, 1);
+        const QueryResult& pop = parts[4][i].result;
+        for (size_t row = 0; row < pop.size(); row++) popByCourse[pop.text(row, 0)] += pop.integer(row, 1);
+    }
+
+    cout << "\n   [1] TOTAL FEES AND STUDENT DEBT\n";
+    cout << "   " << string(60, '-') << endl;
+
+    Money totalRev = Money::fromCents(sumCents(revParts.data(), revParts.size()));
+    Money totalDebt = Money::fromCents(sumCents(debtParts.data(), debtParts.size()));
+    cout << "   Total Fees Collected:  "; setColor(10); cout << "$" << totalRev.toString() << endl; setColor(7);
+    cout << "   Outstanding Debt:      "; setColor(12); cout << "$" << totalDebt.toString() << endl; setColor(7);
+    cout << "   Total Students:        " << totalStu << endl;
+
+    cout << "\n\n   [2] TOTAL COLLECTED FEES BY COURSE\n";
+    cout << "   " << string(60, '-') << endl;
+
+    // Top courses by revenue
+    vector<pair<Money, string>> revSorted;
+    for (auto& kv : revByCourse) revSorted.push_back({ kv.second, kv.first });
+    sort(revSorted.begin(), revSorted.end(), [](const pair<Money, string>& a, const pair<Money, string>& b) { return a.first > b.first; });
+
+    string courseNames[MAX_ITEMS];
+    int64_t revenues[MAX_ITEMS]; // cents
+    int count = 0;
+
+    for (size_t row = 0; row < revSorted.size(); row++) {
+        if (count >= MAX_ITEMS) break; // prevent crash
+        courseNames[count] = revSorted[row].second;
+        revenues[count] = revSorted[row].first.cents;
+        count++;
+    }
+    int64_t maxRev = maxCents(revenues, count);
+
+    if (count == 0) cout << "   No revenue data available.\n";
+    else {
+        for (int i = 0; i < count; i++) {
+            
+            int barLen = 0;
+            if (maxRev > 0) {
+                barLen = (int)(((double)revenues[i] / maxRev) * 30.0);
+            }
+
+            cout << "   " << left << setw(20) << courseNames[i] << " |";
+            if (revenues[i] > 0) setColor(11); else setColor(8);
+
+            // Draw the blocks
+            for (int j = 0; j < barLen; j++) cout << "\xFE";
+
+            setColor(7);
+            cout << " $" << Money::fromCents(revenues[i]).toString() << endl;
+        }
+    }
+
+    cout << "\n\n   [3] ENROLLMENT BY COURSE\n";
+    cout << "   " << string(60, '-') << endl;
+
+    vector<pair<int, string>> popSorted;
+    for (auto& kv : popByCourse) popSorted.push_back({ kv.second, kv.first });
+    sort(popSorted.begin(), popSorted.end(), [](const pair<int, string>& a, const pair<int, string>& b) { return a.first > b.first; });
+
+    // REUSE ARRAYS (Reuse memory logic)
+    // string courseNames[MAX_ITEMS] - reused
+    int enrolls[MAX_ITEMS];
+    count = 0;
+    int maxPop = 0;
+
+    for (size_t row = 0; row < popSorted.size(); row++) {
+        if (count >= MAX_ITEMS) break;
+        courseNames[count] = popSorted[row].second;
+        enrolls[count] = popSorted[row].first;
+        if (enrolls[count] > maxPop) maxPop = enrolls[count];
+        count++;
+    }
+
+    if (count == 0) cout << "   No enrollment data available.\n";
+    else {
+        for (int i = 0; i < count; i++) {
+            int barLen = 0;
+            if (maxPop > 0) {
+                barLen = (int)(((double)enrolls[i] / maxPop) * 30.0);
+            }
+            cout << "   " << left << setw(20) << courseNames[i] << " |";
+            if (enrolls[i] > 0) setColor(14); else setColor(8);
+            for (int j = 0; j < barLen; j++) cout << "\xFE";
+            setColor(7);
+            cout << " " << enrolls[i] << " Students" << endl;
+        }
+    }
+    printShardTimings(parts[0]);
+    resultCache.printStats();
+    cout << "\n\nPress any key..."; (void)_getch();
+}
+
+// Grade bands for the reliability score, best first
+const int GRADE_COUNT = 5;
+const double GRADE_MIN[GRADE_COUNT] = { 95, 85, 70, 50, 0 };
+const string GRADE_LABEL[GRADE_COUNT] = { "S (Elite)", "A (Good)", "B (Avg)", "C (Risk)", "F (Fail)" };
+const int GRADE_COLOR[GRADE_COUNT] = { 11, 10, 14, 12, 4 };
+
+int gradeIndex(double score) {
+    int g = 0;
+    for (int k = 0; k < GRADE_COUNT - 1; k++) g += (score < GRADE_MIN[k]);
+    return g;
+}
+
+// Counts scores per grade band. Each threshold is one branch-free counting loop
+// over the array, which the compiler turns into SIMD compares.
+void gradeHistogram(const double* scores, size_t n, size_t counts[GRADE_COUNT]) {
+    size_t below[GRADE_COUNT - 1];
+    for (int k = 0; k < GRADE_COUNT - 1; k++) {
+        double limit = GRADE_MIN[k];
+        size_t c = 0;
+        for (size_t i = 0; i < n; i++) c += (scores[i] < limit);
+        below[k] = c;
+    }
+    counts[0] = n - below[0];
+    for (int k = 1; k < GRADE_COUNT - 1; k++) counts[k] = below[k - 1] - below[k];
+    counts[GRADE_COUNT - 1] = below[GRADE_COUNT - 2];
+}
+
+// Value at fraction p (0..1) of the sorted scores. Reorders 'scores'.
+double scoreAtFraction(vector<double>& scores, double p) {
+    if (scores.empty()) return 0.0;
+    size_t k = (size_t)(p * (scores.size() - 1) + 0.5);
+    nth_element(execution::par, scores.begin(), scores.begin() + k, scores.end());
+    return scores[k];
+}
+
+void showReliabilityScore(sql::Connection* conn) {
+    system("cls"); drawHeader("STUDENT RELIABILITY SCORE (SRS)", 13);
+    // Only raw per-student counts come from MySQL; rates, ranking and cohorts are worked out here
+    string countsQuery = "SELECT S.StudentID, S.StudentName, A.Present, A.Total, F.Paid, F.Due FROM STUDENT S "
+        "JOIN (SELECT StudentID, SUM(Status = 'Present') AS Present, COUNT(*) AS Total FROM ATTENDANCE_ALL GROUP BY StudentID) A ON A.StudentID = S.StudentID "
+        "JOIN (SELECT StudentID, SUM(AmountPaid) AS Paid, SUM(AmountDue) AS Due FROM STUDENT_FEE GROUP BY StudentID) F ON F.StudentID = S.StudentID";
+    string courseQuery = "SELECT SC.StudentID, C.CourseName FROM STUDENT_COURSE SC JOIN COURSE C ON SC.CourseID = C.CourseID";
+
+    vector<PendingShard> countsPending = scatterSubmit(conn, countsQuery);
+    vector<PendingShard> coursesPending = scatterSubmit(conn, courseQuery);
+    vector<ShardResult> parts = scatterWait(countsPending);
+    vector<ShardResult> courseParts = scatterWait(coursesPending);
+    string err = scatterError(parts);
+    if (err.empty()) err = scatterError(courseParts);
+    if (!err.empty()) { drawError(err); cout << "\n\nPress any key..."; (void)_getch(); return; }
+
+    auto start = chrono::steady_clock::now();
+    struct ScoreRow { string campus; string name; double att; double pay; double score; double pctl; };
+    vector<ScoreRow> rows;
+    unordered_map<long long, size_t> rowOf; // (campus << 32 | StudentID) -> row, to place students in course cohorts
+    for (size_t c = 0; c < parts.size(); c++) {
+        const QueryResult& r = parts[c].result;
+        for (size_t i = 0; i < r.size(); i++) {
+            int total = r.integer(i, 3);
+            Money paid = r.money(i, 4), due = r.money(i, 5);
+            double att = total > 0 ? r.integer(i, 2) * 100.0 / total : 0.0;
+            double pay = due.cents > 0 ? paid.cents * 100.0 / due.cents : 0.0;
+            rowOf[((long long)c << 32) | (unsigned int)r.integer(i, 0)] = rows.size();
+            rows.push_back({ parts[c].campus, r.text(i, 1), att, pay, (att + pay) / 2.0, 0.0 });
+        }
+    }
+
+    vector<double> scores(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) scores[i] = rows[i].score;
+
+    // Course cohorts, filled before the rows are reordered
+    map<string, vector<double>> cohorts;
+    for (size_t c = 0; c < courseParts.size(); c++) {
+        const QueryResult& r = courseParts[c].result;
+        for (size_t i = 0; i < r.size(); i++) {
+            auto it = rowOf.find(((long long)c << 32) | (unsigned int)r.integer(i, 0));
+            if (it != rowOf.end()) cohorts[r.text(i, 1)].push_back(scores[it->second]);
+        }
+    }
+
+    sort(execution::par, rows.begin(), rows.end(), [](const ScoreRow& a, const ScoreRow& b) { return a.score > b.score; });
+
+    // Percentile = share of students scoring lower, counting ties as half
+    size_t n = rows.size();
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && rows[j].score == rows[i].score) j++;
+        double pctl = ((n - j) + 0.5 * (j - i)) * 100.0 / n;
+        for (size_t k = i; k < j; k++) rows[k].pctl = pctl;
+        i = j;
+    }
+
+    size_t gradeCounts[GRADE_COUNT];
+    gradeHistogram(scores.data(), n, gradeCounts);
+    double scoreSum = 0.0;
+    for (double s : scores) scoreSum += s;
+    double p10 = scoreAtFraction(scores, 0.10);
+    double median = scoreAtFraction(scores, 0.50);
+    double p90 = scoreAtFraction(scores, 0.90);
+
+    struct CohortRow { string course; size_t students; double avg; double median; double best; };
+    vector<CohortRow> cohortRows;
+    for (auto& kv : cohorts) {
+        vector<double>& v = kv.second;
+        double sum = 0.0, best = 0.0;
+        for (double s : v) { sum += s; best = max(best, s); }
+        double mid = scoreAtFraction(v, 0.50);
+        cohortRows.push_back({ kv.first, v.size(), sum / v.size(), mid, best });
+    }
+    sort(cohortRows.begin(), cohortRows.end(), [](const CohortRow& a, const CohortRow& b) { return a.median > b.median; });
+    double rankMs = secondsSince(start) * 1000.0;
+
+    if (n == 0) {
+        drawError("No data found (Need Attendance + Fees).");
+        cout << "\n\nPress any key..."; (void)_getch();
+        return;
+    }
+
+    bool sharded = (dbConfig.shardCount > 0);
+    cout << "\n   " << left << setw(7) << "Rank" << setw(25) << "Student Name";
+    if (sharded) cout << setw(12) << "Campus";
+    cout << setw(11) << "Attend %" << setw(10) << "Fees %" << setw(9) << "Score" << setw(8) << "Pctl" << "Grade" << endl;
+    cout << "   " << string(sharded ? 92 : 80, '-') << endl;
+
+    size_t shown = min(n, (size_t)MAX_ITEMS);
+    for (size_t i = 0; i < shown; i++) {
+        const ScoreRow& row = rows[i];
+        string name = row.name;
+        if (name.length() > 22) name = name.substr(0, 19) + "...";
+        int g = gradeIndex(row.score);
+
+        cout << "   " << left << setw(7) << (i + 1) << setw(25) << name;
+        if (sharded) cout << setw(12) << row.campus.substr(0, 11);
+        cout << fixed << setprecision(0) << setw(11) << row.att << setw(10) << row.pay
+            << setprecision(1) << setw(9) << row.score << setprecision(0) << setw(8) << row.pctl;
+        setColor(GRADE_COLOR[g]); cout << GRADE_LABEL[g] << endl; setColor(7);
+    }
+    if (shown < n) { setColor(8); cout << "   ... top " << shown << " of " << n << " shown" << endl; setColor(7); }
+
+    cout << "   " << string(sharded ? 92 : 80, '-') << endl;
+    double globalAvg = scoreSum / n;
+    cout << "   University Average Score: ";
+    if (globalAvg >= 80) setColor(10); else if (globalAvg >= 60) setColor(14); else setColor(12);
+    cout << fixed << setprecision(1) << globalAvg << "/100"; setColor(7);
+    cout << "   Median: " << median << "   P10: " << p10 << "   P90: " << p90 << endl;
+
+    cout << "\n   Grade Distribution" << endl;
+    size_t biggest = 1;
+    for (int g = 0; g < GRADE_COUNT; g++) biggest = max(biggest, gradeCounts[g]);
+    for (int g = 0; g < GRADE_COUNT; g++) {
+        cout << "   " << left << setw(12) << GRADE_LABEL[g];
+        setColor(GRADE_COLOR[g]); cout << string((size_t)(gradeCounts[g] * 40 / biggest), '\xDB'); setColor(7);
+        cout << " " << gradeCounts[g] << " (" << fixed << setprecision(1) << gradeCounts[g] * 100.0 / n << "%)" << endl;
+    }
+
+    if (!cohortRows.empty()) {
+        cout << "\n   " << left << setw(30) << "Course Cohort" << setw(10) << "Students" << setw(10) << "Average" << setw(10) << "Median" << "Best" << endl;
+        cout << "   " << string(68, '-') << endl;
+        for (size_t i = 0; i < cohortRows.size() && i < (size_t)MAX_ITEMS; i++) {
+            const CohortRow& c = cohortRows[i];
+            cout << "   " << left << setw(30) << c.course.substr(0, 28) << setw(10) << c.students << fixed << setprecision(1)
+                << setw(10) << c.avg << setw(10) << c.median << c.best << endl;
+        }
+    }
+
+    cout << "\n   Total Students Ranked: " << n;
+    setColor(8); cout << "  (" << fixed << setprecision(1) << rankMs << " ms)" << endl; setColor(7);
+    printShardTimings(parts);
+    cout << "\n\nPress any key..."; (void)_getch();
+}
+
+// Debt aging buckets, by days since the fee was billed (kept up to date by refreshAging)
+const int AGING_BUCKETS = 4;
+const string AGING_COLUMNS[AGING_BUCKETS] = { "Days0_30", "Days31_60", "Days61_90", "Days90Plus" };
+const string AGING_LABELS[AGING_BUCKETS] = { "0-30", "31-60", "61-90", "90+" };
+
+void showDebtList(sql::Connection* conn) {
+    system("cls"); drawHeader("STUDENTS WITH UNPAID FEES", 12);
+    // Reads the precomputed aging tables; nothing here scans STUDENT_FEE or PAYMENT
+    vector<PendingShard> listPending = scatterSubmit(conn, "SELECT A.StudentID, S.StudentName, A.Days0_30, A.Days31_60, A.Days61_90, A.Days90Plus FROM DEBT_AGING A JOIN STUDENT S ON S.StudentID = A.StudentID");
+    vector<PendingShard> sweepPending = scatterSubmit(conn, "SELECT LastSweep FROM AGING_STATE WHERE ID = 1");
+    vector<ShardResult> parts = scatterWait(listPending);
+    vector<ShardResult> sweeps = scatterWait(sweepPending);
+    string err = scatterError(parts);
+    if (err.empty()) err = scatterError(sweeps);
+    if (!err.empty()) { drawError(err); cout << "\nPress any key..."; (void)_getch(); return; }
+
+    struct DebtRow { string campus; int id; string name; Money buckets[AGING_BUCKETS]; Money debt; };
+    vector<DebtRow> rows;
+    Money totalBuckets[AGING_BUCKETS];
+    for (const ShardResult& p : parts) {
+        for (size_t i = 0; i < p.result.size(); i++) {
+            DebtRow row;
+            row.campus = p.campus;
+            row.id = p.result.integer(i, 0);
+            row.name = p.result.text(i, 1);
+            for (int b = 0; b < AGING_BUCKETS; b++) { row.buckets[b] = p.result.money(i, 2 + b); row.debt += row.buckets[b]; totalBuckets[b] += row.buckets[b]; }
+            rows.push_back(row);
+        }
+    }
+    // Biggest debtors first across all campuses
+    sort(rows.begin(), rows.end(), [](const DebtRow& a, const DebtRow& b) { return a.debt > b.debt; });
+
+    // The list is only as current as the campus swept longest ago ("never" if one wasn't)
+    string asOf;
+    bool unswept = false;
+    for (const ShardResult& s : sweeps) {
+        string last = s.result.text(0, 0);
+        if (last.empty()) unswept = true;
+        else if (asOf.empty() || last < asOf) asOf = last;
+    }
+    if (unswept) asOf.clear();
+
+    bool sharded = (dbConfig.shardCount > 0);
+    cout << "   [FILTER] Outstanding debt per student by days since billing (aged " << (asOf.empty() ? "never" : asOf) << ").\n\n";
+    cout << "   " << left << setw(6) << "ID" << setw(24) << "Student Name";
+    if (sharded) cout << setw(12) << "Campus";
+    cout << right;
+    for (int b = 0; b < AGING_BUCKETS; b++) cout << setw(11) << AGING_LABELS[b];
+    cout << setw(13) << "Total ($)" << endl;
+    int width = sharded ? 99 : 87;
+    cout << "   " << string(width, '-') << endl;
+
+    for (const DebtRow& row : rows) {
+        cout << "   " << left << setw(6) << row.id << setw(24) << row.name.substr(0, 22);
+        if (sharded) cout << setw(12) << row.campus.substr(0, 11);
+        cout << right;
+        for (int b = 0; b < AGING_BUCKETS; b++) {
+            if (b == AGING_BUCKETS - 1 && row.buckets[b].cents > 0) setColor(12);
+            cout << setw(11) << row.buckets[b].toString(); setColor(7);
+        }
+        cout << setw(13) << row.debt.toString() << endl;
+    }
+
+    if (rows.empty()) drawSuccess("Amazing! No students owe any fees.");
+    else {
+        Money grandTotal;
+        cout << "   " << string(width, '-') << endl;
+        setColor(12);
+        cout << "   " << left << setw(sharded ? 42 : 30) << "TOTAL OUTSTANDING:" << right;
+        for (int b = 0; b < AGING_BUCKETS; b++) { cout << setw(11) << totalBuckets[b].toString(); grandTotal += totalBuckets[b]; }
+        cout << setw(13) << grandTotal.toString() << endl;
+        setColor(7);
+    }
+    printShardTimings(parts);
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+
+// Students whose attendance over the last 4 weeks is low, or has dropped well below
+// their term average, on every campus. Read from each campus's attendance windows;
+// only windows that are missing or stale are reloaded, with one scatter.
+void showAtRiskStudents(sql::Connection* conn) {
+    system("cls"); drawHeader("AT-RISK STUDENTS (LAST 4 WEEKS)", 12);
+    const double LOW_RATE = 70.0;  // under this recently = at risk
+    const double DROP = 20.0;      // or this many points below the term rate
+
+    // One store per part of a scatter, in scatterSubmit() order
+    vector<WindowStore*> stores;
+    if (dbConfig.shardCount == 0) stores.push_back(&windowStoreOf(conn));
+    for (int i = 0; i < dbConfig.shardCount; i++) stores.push_back(&windowStoreAt(dbConfig.shardHosts[i], dbConfig.shardSchemas[i]));
+    bool stale = false;
+    for (WindowStore* s : stores) if (!windowStoreFresh(*s)) stale = true;
+    if (stale) {
+        vector<ShardResult> loads = scatterQuery(conn, WINDOW_LOAD_SQL, { to_string(WINDOW_TERM_DAYS - 1) });
+        string err = scatterError(loads);
+        if (!err.empty()) { drawError(err); cout << "\nPress any key..."; (void)_getch(); return; }
+        for (size_t i = 0; i < loads.size(); i++) fillWindowStore(*stores[i], loads[i].result);
+    }
+
+    int today = todayNumber();
+    struct RiskRow { int part; int id; double recent; double term; };
+    vector<RiskRow> rows;
+    for (int part = 0; part < (int)stores.size(); part++) {
+        for (auto& kv : stores[part]->students) {
+            kv.second.advanceTo(today);
+            double recent = kv.second.recentRate(), term = kv.second.termRate();
+            if (recent < 0) continue;
+            if (recent < LOW_RATE || (term >= 0 && term - recent >= DROP)) rows.push_back({ part, kv.first, recent, term });
+        }
+    }
+    // Lowest first across all campuses
+    sort(rows.begin(), rows.end(), [](const RiskRow& a, const RiskRow& b) { return a.recent < b.recent; });
+    if (rows.size() > (size_t)MAX_ITEMS) rows.resize(MAX_ITEMS);
+
+    if (rows.empty()) { drawSuccess("Nobody is at risk right now."); cout << "\nPress any key..."; (void)_getch(); return; }
+
+    // Names for just the students we show; each campus answers for its own IDs
+    string ids;
+    for (const RiskRow& r : rows) ids += (ids.empty() ? "" : ",") + to_string(r.id);
+    vector<ShardResult> parts = scatterQuery(conn, "SELECT StudentID, StudentName FROM STUDENT WHERE StudentID IN (" + ids + ")");
+    string err = scatterError(parts);
+    if (!err.empty()) drawError(err);
+    map<pair<int, int>, string> names;
+    for (int part = 0; part < (int)parts.size(); part++) {
+        for (size_t i = 0; i < parts[part].result.size(); i++) names[{ part, parts[part].result.integer(i, 0) }] = parts[part].result.text(i, 1);
+    }
+
+    bool sharded = (dbConfig.shardCount > 0);
+    cout << "\n   " << left << setw(6) << "ID" << setw(30) << "Student Name";
+    if (sharded) cout << setw(12) << "Campus";
+    cout << setw(12) << "4 Weeks" << setw(12) << "Term" << "Trend" << endl;
+    cout << "   " << string(sharded ? 82 : 70, '-') << endl;
+    for (const RiskRow& r : rows) {
+        cout << "   " << left << setw(6) << r.id << setw(30) << names[{ r.part, r.id }].substr(0, 28);
+        if (sharded) cout << setw(12) << parts[r.part].campus.substr(0, 11);
+        setColor(12); cout << setw(12) << (to_string((int)r.recent) + "%"); setColor(7);
+        cout << setw(12) << (r.term < 0 ? string("-") : to_string((int)r.term) + "%");
+        if (r.term >= 0 && r.term - r.recent >= DROP) { setColor(12); cout << "DROPPING"; setColor(7); }
+        cout << endl;
+    }
+    cout << "\n   Students at risk: " << rows.size() << endl;
+    printShardTimings(parts);
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// ===================== DATA TOOLS =====================
+
+bool isValidDate(const string& s) {
+    // Only accept YYYY-MM-DD so nothing weird reaches the query
+    if (s.length() != 10 || s[4] != '-' || s[7] != '-') return false;
+    for (int i = 0; i < 10; i++) {
+        if (i == 4 || i == 7) continue;
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    return true;
+}
+
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// CSV needs quotes around anything with a comma, quote or newline in it
+void appendCsvField(string& rec, const string& v) {
+    if (v.find_first_of(",\"\r\n") == string::npos) { rec += v; return; }
+    rec += '"';
+    for (char c : v) { if (c == '"') rec += '"'; rec += c; }
+    rec += '"';
+}
+
+// Binary strings are stored as [uint16 length][bytes]
+void appendBinString(string& rec, const string& v) {
+    uint16_t len = (uint16_t)(v.size() > 65535 ? 65535 : v.size());
+    rec.append((const char*)&len, sizeof(len));
+    rec.append(v.data(), len);
+}
+
+// Exports every PAYMENT row (with student and fee names) to a file.
+// The result set is read with TYPE_FORWARD_ONLY so the driver streams rows from the
+// server one by one instead of loading the whole ledger into memory first.
+//
+// Binary layout (little endian):
+//   header: "SFLG" + uint32 version(1)
+//   record: uint32 recordLength, then
+//           str TransactionRef, int64 AmountCents, str PaymentDate,
+//           int32 StudentID, str StudentName, str FeeName
+void exportLedger(sql::Connection* conn) {
+    system("cls"); drawHeader("EXPORT TRANSACTION LEDGER", 13);
+    cout << "   (Leave dates blank to export everything)\n\n";
+    string fromDate = inputString("From Date (YYYY-MM-DD): ");
+    string toDate = inputString("To Date   (YYYY-MM-DD): ");
+    if ((!fromDate.empty() && !isValidDate(fromDate)) || (!toDate.empty() && !isValidDate(toDate))) {
+        drawError("Dates must look like 2024-01-31."); (void)_getch(); return;
+    }
+    string fmt = inputString("Format (1 = CSV, 2 = Binary): ");
+    bool binary = (fmt == "2");
+    if (fmt != "1" && fmt != "2") { drawError("Unknown format."); (void)_getch(); return; }
+    string path = inputString("Output File: ");
+    if (path.empty()) path = binary ? "ledger_export.bin" : "ledger_export.csv";
+
+    string query = "SELECT P.TransactionRef, P.Amount, P.PaymentDate, S.StudentID, S.StudentName, F.FeeName FROM PAYMENT_ALL P JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID JOIN STUDENT S ON P.StudentID = S.StudentID WHERE 1=1";
+    if (!fromDate.empty()) query += " AND P.PaymentDate >= ?";
+    if (!toDate.empty()) query += " AND P.PaymentDate < DATE_ADD(?, INTERVAL 1 DAY)";
+    query += " ORDER BY P.PaymentDate ASC";
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) { drawError("Cannot open " + path); (void)_getch(); return; }
+    // Big write buffer so we don't hit the disk for every row
+    const size_t WRITE_BUFFER = 4 * 1024 * 1024;
+    char* writeBuf = new char[WRITE_BUFFER];
+    setvbuf(out, writeBuf, _IOFBF, WRITE_BUFFER);
+
+    long long rows = 0, bytes = 0;
+    bool failed = false, writeFailed = false;
+    if (binary) {
+        uint32_t version = 1;
+        writeFailed = fwrite("SFLG", 1, 4, out) != 4 || fwrite(&version, sizeof(version), 1, out) != 1;
+        bytes = 8;
+    }
+    else {
+        string head = "TransactionRef,Amount,PaymentDate,StudentID,StudentName,FeeName\n";
+        writeFailed = fwrite(head.data(), 1, head.size(), out) != head.size();
+        bytes = (long long)head.size();
+    }
+
+    auto start = chrono::steady_clock::now();
+    try {
+        sql::PreparedStatement* p = conn->prepareStatement(query);
+        p->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
+        int param = 1;
+        if (!fromDate.empty()) p->setString(param++, fromDate);
+        if (!toDate.empty()) p->setString(param++, toDate);
+        sql::ResultSet* r = p->executeQuery();
+
+        string rec;
+        char amountText[32];
+        cout << "\n";
+        while (!writeFailed && r->next()) {
+            string ref = r->getString(1);
+            long long cents = Money::fromColumn(r->getString(2)).cents;
+            string date = r->getString(3);
+            int sid = r->getInt(4);
+            string sName = r->getString(5);
+            string fName = r->getString(6);
+
+            rec.clear();
+            if (binary) {
+                appendBinString(rec, ref);
+                int64_t c64 = cents; rec.append((const char*)&c64, sizeof(c64));
+                appendBinString(rec, date);
+                int32_t s32 = sid; rec.append((const char*)&s32, sizeof(s32));
+                appendBinString(rec, sName);
+                appendBinString(rec, fName);
+                uint32_t len = (uint32_t)rec.size();
+                if (fwrite(&len, sizeof(len), 1, out) != 1) { writeFailed = true; break; }
+                bytes += sizeof(len);
+            }
+            else {
+                appendCsvField(rec, ref); rec += ',';
+                snprintf(amountText, sizeof(amountText), "%s%lld.%02lld,", cents < 0 ? "-" : "", llabs(cents) / 100, llabs(cents) % 100);
+                rec += amountText;
+                appendCsvField(rec, date); rec += ',';
+                rec += to_string(sid) + ',';
+                appendCsvField(rec, sName); rec += ',';
+                appendCsvField(rec, fName); rec += '\n';
+            }
+            if (fwrite(rec.data(), 1, rec.size(), out) != rec.size()) { writeFailed = true; break; }
+            bytes += (long long)rec.size();
+            rows++;
+            if (rows % 100000 == 0) cout << "\r   Exported " << rows << " rows..." << flush;
+        }
+        delete r; delete p;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); failed = true; }
+
+    // The buffer is only written out here, so a full disk often shows up in fclose
+    if (fclose(out) != 0) writeFailed = true;
+    delete[] writeBuf;
+    if (writeFailed && !failed) { drawError("Cannot write " + path + " (disk full?). The file is incomplete."); failed = true; }
+    if (failed) { cout << "   Export stopped after " << rows << " rows.\n"; (void)_getch(); return; }
+
+    double secs = secondsSince(start);
+    double mb = bytes / (1024.0 * 1024.0);
+    cout << "\r   " << string(40, ' ') << "\r";
+    drawSuccess("Export finished: " + path);
+    cout << "   Rows:       " << rows << endl;
+    cout << "   Size:       " << fixed << setprecision(2) << mb << " MB" << endl;
+    cout << "   Time:       " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput: " << fixed << setprecision(2) << (secs > 0 ? mb / secs : 0.0) << " MB/s, " << (long long)(secs > 0 ? rows / secs : 0) << " rows/s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// Recomputes COURSE_REVENUE from the PAYMENT ledger in one transaction.
+// Normally payFees() keeps it current; this is for first setup or after manual fixes.
+void rebuildCourseRevenue(sql::Connection* conn, bool interactive) {
+    if (interactive) { system("cls"); drawHeader("REBUILD COURSE REVENUE", 13); }
+    try {
+        conn->setAutoCommit(false);
+        sql::Statement* s = conn->createStatement();
+        s->executeUpdate("DELETE FROM COURSE_REVENUE");
+        int rows = s->executeUpdate("INSERT INTO COURSE_REVENUE (CourseID, TotalCollected, PaymentCount) SELECT F.CourseID, SUM(P.Amount), COUNT(*) FROM PAYMENT_ALL P JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID WHERE F.CourseID IS NOT NULL GROUP BY F.CourseID");
+        delete s;
+        conn->commit();
+        emitBulkJob("Rebuild Course Revenue", rows);
+        if (interactive) drawSuccess("Revenue rebuilt for " + to_string(rows) + " courses.");
+    }
+    catch (sql::SQLException& e) {
+        conn->rollback();
+        if (!interactive) { conn->setAutoCommit(true); throw; } // ensureSchema reports it
+        drawError("Rebuild Failed: " + string(e.what()));
+    }
+    conn->setAutoCommit(true);
+    if (interactive) (void)_getch();
+}
+
+bool selectFee(sql::Connection* conn, int& outFeeID, string& outFeeName, Money& outAmount) {
+    system("cls"); drawHeader("SELECT FEE", 11);
     try {
         sql::Statement* stmt = conn->createStatement();
+        sql::ResultSet* res = stmt->executeQuery("SELECT FeeID, FeeName, Amount FROM FEE ORDER BY FeeID ASC");
+
+        int fIds[MAX_ITEMS];
+        string fNames[MAX_ITEMS];
+        Money fAmounts[MAX_ITEMS];
+        int count = 0;
 
-        cout << "\n   [1] TOTAL FEES AND STUDENT DEBT\n";
+        cout << "\n   " << left << setw(5) << "ID" << setw(40) << "Fee Name" << "Amount($)" << endl;
         cout << "   " << string(60, '-') << endl;
+        while (res->next()) {
+            if (count >= MAX_ITEMS) break;
+            fIds[count] = res->getInt("FeeID");
+            fNames[count] = res->getString("FeeName");
+            fAmounts[count] = Money::fromColumn(res->getString("Amount"));
+            cout << "   " << left << setw(5) << fIds[count] << setw(40) << fNames[count] << "$" << fAmounts[count].toString() << endl;
+            count++;
+        }
+        delete res; delete stmt;
+
+        if (count == 0) { drawError("No fees found."); return false; }
+
+        string idStr = inputString("\nEnter Fee ID: ");
+        if (idStr.empty()) return false;
+        int inputID = stoi(idStr);
+        for (int i = 0; i < count; i++) {
+            if (fIds[i] == inputID) {
+                outFeeID = fIds[i]; outFeeName = fNames[i]; outAmount = fAmounts[i];
+                return true;
+            }
+        }
+        drawError("Invalid Fee ID."); return false;
+    }
+    catch (...) { drawError("Invalid input."); return false; }
+}
 
-        // I did these separately because JOINing them all at once returned wrong numbers
-        sql::ResultSet* r1 = stmt->executeQuery("SELECT SUM(Amount) AS Total FROM PAYMENT");
-        double totalRev = 0.0; if (r1->next()) totalRev = r1->getDouble("Total"); delete r1;
+// Bills one FEE to a whole cohort with INSERT ... SELECT, one StudentID range per transaction.
+// Students who already have a STUDENT_FEE row for this fee are skipped, so running the
+// same billing twice does nothing the second time.
+void runBilling(sql::Connection* conn) {
+    int feeID = 0; string feeName; Money amount;
+    if (!selectFee(conn, feeID, feeName, amount)) { (void)_getch(); return; }
+
+    system("cls"); drawHeader("BILLING RUN", 13);
+    cout << "   Fee: " << feeName << " ($" << amount.toString() << ")\n\n";
+    string who = inputString("Bill (1 = All Students, 2 = Students in a Course): ");
+    int courseID = -1; string courseName;
+    if (who == "2") {
+        Money dummy;
+        if (!selectCourse(conn, courseID, courseName, dummy)) { (void)_getch(); return; }
+        system("cls"); drawHeader("BILLING RUN", 13);
+        cout << "   Fee: " << feeName << "  ->  Students in " << courseName << "\n\n";
+    }
+    else if (who != "1") return;
 
-        sql::ResultSet* r2 = stmt->executeQuery("SELECT SUM(AmountDue - AmountPaid) AS Debt FROM STUDENT_FEE");
-        double totalDebt = 0.0; if (r2->next()) totalDebt = r2->getDouble("Debt"); delete r2;
+    if (inputString("Type CONFIRM to start billing: ") != "CONFIRM") return;
 
-        sql::ResultSet* r3 = stmt->executeQuery("SELECT COUNT(*) FROM STUDENT");
-        int totalStu = 0; if (r3->next()) totalStu = r3->getInt(1); delete r3;
+    const int CHUNK = 5000; // StudentIDs per transaction
+    string cohort = (courseID == -1) ? "SELECT StudentID FROM STUDENT WHERE StudentID BETWEEN ? AND ?" : "SELECT StudentID FROM STUDENT_COURSE WHERE CourseID = ? AND StudentID BETWEEN ? AND ?";
+    string insertQ = "INSERT INTO STUDENT_FEE (StudentID, FeeID, AmountDue, AmountPaid, Status) SELECT C.StudentID, F.FeeID, F.Amount, 0, 'Unpaid' FROM (" + cohort + ") C JOIN FEE F ON F.FeeID = ? WHERE NOT EXISTS (SELECT 1 FROM STUDENT_FEE X WHERE X.StudentID = C.StudentID AND X.FeeID = F.FeeID)";
 
-        cout << "   Total Fees Collected:  "; setColor(10); cout << "$" << fixed << setprecision(2) << totalRev << endl; setColor(7);
-        cout << "   Outstanding Debt:      "; setColor(12); cout << "$" << fixed << setprecision(2) << totalDebt << endl; setColor(7);
-        cout << "   Total Students:        " << totalStu << endl;
+    long long billed = 0, committed = 0;
+    string failure;
+    sql::PreparedStatement* ins = nullptr;
+    auto start = chrono::steady_clock::now();
+    try {
+        int lo = 0, hi = -1;
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery(courseID == -1 ? "SELECT MIN(StudentID), MAX(StudentID) FROM STUDENT" : "SELECT MIN(StudentID), MAX(StudentID) FROM STUDENT_COURSE WHERE CourseID = " + to_string(courseID));
+        if (r->next() && !r->isNull(1)) { lo = r->getInt(1); hi = r->getInt(2); }
+        delete r; delete s;
 
-        cout << "\n\n   [2] TOTAL COLLECTED FEES BY COURSE\n";
-        cout << "   " << string(60, '-') << endl;
+        if (hi < lo) { drawError("Nobody to bill."); (void)_getch(); return; }
 
-        // This query was hard. If I don't use COALESCE, null values break the code.
-        string revQuery = "SELECT C.CourseName, COALESCE(SUM(P.Amount), 0) as Metric FROM COURSE C LEFT JOIN STUDENT_COURSE SC ON C.CourseID = SC.CourseID LEFT JOIN PAYMENT P ON SC.StudentID = P.StudentID GROUP BY C.CourseID, C.CourseName ORDER BY Metric DESC";
+        ins = conn->prepareStatement(insertQ);
+        conn->setAutoCommit(false);
+        for (int from = lo; from <= hi; from += CHUNK) {
+            int to = (hi - from < CHUNK) ? hi : from + CHUNK - 1;
+            int param = 1;
+            if (courseID != -1) ins->setInt(param++, courseID);
+            ins->setInt(param++, from);
+            ins->setInt(param++, to);
+            ins->setInt(param++, feeID);
+            billed += ins->executeUpdate();
+            refreshAging(conn, "StudentID BETWEEN ? AND ?", { to_string(from), to_string(to) });
+            conn->commit();
+            committed = billed;
+
+            double pct = (hi == lo) ? 100.0 : (to - lo + 1) * 100.0 / (hi - lo + 1);
+            cout << "\r   Progress: " << fixed << setprecision(1) << setw(5) << pct << "%   Billed: " << billed << flush;
+        }
+    }
+    catch (sql::SQLException& e) { try { conn->rollback(); } catch (...) {} failure = e.what(); }
+    delete ins;
+    conn->setAutoCommit(true);
+    emitBulkJob("Billing Run", committed, feeID);
 
-        sql::ResultSet* r4 = stmt->executeQuery(revQuery);
+    double secs = secondsSince(start);
+    cout << "\n";
+    if (!failure.empty()) {
+        // Chunks committed before the error stay billed; running again skips them
+        drawError("Billing stopped: " + failure);
+        cout << "   Rows billed before the error: " << committed << endl;
+        cout << "\nPress any key..."; (void)_getch();
+        return;
+    }
+    drawSuccess("Billing run finished.");
+    cout << "   New fee rows:  " << billed << endl;
+    cout << "   Time:          " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:    " << (long long)(secs > 0 ? billed / secs : 0) << " rows/s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
 
-        string courseNames[MAX_ITEMS];
-        double revenues[MAX_ITEMS];
-        int count = 0;
-        double maxRev = 0;
+// One badge tap parsed from the reader log
+struct Tap {
+    int studentID;
+    int courseID;
+    char date[11];   // YYYY-MM-DD
+    int minuteOfDay; // 0..1439
+};
+
+// Parses "StudentID,CourseID,YYYY-MM-DD HH:MM[:SS]". Returns false for junk lines.
+bool parseTapLine(const string& line, Tap& t) {
+    const char* p = line.c_str();
+    char* end;
+    long sid = strtol(p, &end, 10);
+    if (end == p || *end != ',') return false;
+    p = end + 1;
+    long cid = strtol(p, &end, 10);
+    if (end == p || *end != ',') return false;
+    p = end + 1;
+    while (*p == ' ') p++;
+    string ts = p;
+    if (ts.length() < 16 || !isValidDate(ts.substr(0, 10)) || ts[13] != ':') return false;
+    int hh = atoi(ts.substr(11, 2).c_str()), mm = atoi(ts.substr(14, 2).c_str());
+    if (hh > 23 || mm > 59 || sid <= 0 || cid <= 0 || cid > 65535) return false;
+    t.studentID = (int)sid; t.courseID = (int)cid;
+    memcpy(t.date, ts.c_str(), 10); t.date[10] = 0;
+    t.minuteOfDay = hh * 60 + mm;
+    return true;
+}
+
+// Reads card-reader tap logs and records them as ATTENDANCE.
+// A reader thread parses the file into a BoundedQueue; this thread drops repeat taps,
+// stages the rest in a temporary table and merges each batch into ATTENDANCE with
+// one UPDATE and one INSERT ... SELECT. Only students enrolled in the course are recorded,
+// and a tap never turns an existing 'Present' into 'Late'.
+void ingestTapLog(sql::Connection* conn) {
+    system("cls"); drawHeader("INGEST CARD TAPS", 13);
+    cout << "   Log format: StudentID,CourseID,YYYY-MM-DD HH:MM:SS (one tap per line)\n\n";
+    string path = inputString("Tap Log File: ");
+    if (path.empty()) return;
+    string startStr = inputString("Class Start Time (HH:MM): ");
+    string graceStr = inputString("Late After (minutes, default 10): ");
+    string mode = inputString("Mode (1 = Read Once, 2 = Follow File Until ESC): ");
+    if (startStr.length() != 5 || startStr[2] != ':') { drawError("Start time must look like 08:30."); (void)_getch(); return; }
+
+    int cutoff = 0;
+    try {
+        cutoff = stoi(startStr.substr(0, 2)) * 60 + stoi(startStr.substr(3, 2)) + (graceStr.empty() ? 10 : stoi(graceStr));
+    }
+    catch (...) { drawError("Invalid input."); (void)_getch(); return; }
+    bool follow = (mode == "2");
+
+    ifstream in(path);
+    if (!in) { drawError("Cannot open " + path); (void)_getch(); return; }
+
+    const size_t QUEUE_SIZE = 65536;
+    const int BATCH = 2000;
+    BoundedQueue<Tap> queue(QUEUE_SIZE);
+    atomic<long long> linesRead(0), badLines(0);
+    atomic<bool> stopReading(false);
+
+    // Reader thread: parse lines and hand them over. Blocks when the queue is full.
+    thread reader([&]() {
+        string line;
+        while (!stopReading) {
+            if (!getline(in, line)) {
+                if (!follow) break;
+                in.clear();
+                Sleep(200); // wait for the reader to append more taps
+                continue;
+            }
+            if (line.empty()) continue;
+            linesRead++;
+            Tap t;
+            if (!parseTapLine(line, t)) { badLines++; continue; }
+            if (!queue.push(t)) break;
+        }
+        queue.close();
+    });
+
+    long long accepted = 0, duplicates = 0, updated = 0, inserted = 0, committed = 0;
+    // Key = student | course | day. Only used to skip repeat taps before they hit the DB,
+    // the merge itself is safe to repeat, so the map is simply cleared when it gets big.
+    unordered_map<uint64_t, char> seen;
+    const size_t SEEN_LIMIT = 1000000;
+    auto start = chrono::steady_clock::now();
+    string failure;
+
+    try {
+        sql::Statement* s = conn->createStatement();
+        s->execute("CREATE TEMPORARY TABLE IF NOT EXISTS TAP_STAGE (StudentID INT NOT NULL, CourseID INT NOT NULL, AttDate DATE NOT NULL, Status VARCHAR(10) NOT NULL, PRIMARY KEY (StudentID, CourseID, AttDate)) ENGINE=MEMORY");
+        s->execute("DELETE FROM TAP_STAGE");
+
+        string values;
+        int staged = 0;
+        bool done = false;
+        while (!done) {
+            Tap t;
+            bool got = queue.pop(t, 100);
+            if (got) {
+                char status = (t.minuteOfDay <= cutoff) ? 'P' : 'L';
+                int dayNo = atoi(t.date) * 372 + atoi(t.date + 5) * 31 + atoi(t.date + 8); // unique per date, fits 16 bits after masking
+                uint64_t key = ((uint64_t)t.studentID << 32) | ((uint64_t)t.courseID << 16) | (uint64_t)(dayNo & 0xFFFF);
+                auto it = seen.find(key);
+                if (it != seen.end() && (it->second == 'P' || status == 'L')) { duplicates++; continue; }
+                seen[key] = status;
+                accepted++;
+
+                if (staged > 0) values += ",";
+                values += "(" + to_string(t.studentID) + "," + to_string(t.courseID) + ",'" + t.date + "','" + (status == 'P' ? "Present" : "Late") + "')";
+                staged++;
+            }
+            else if (queue.isClosed()) done = true;
+
+            if (follow && _kbhit() && _getch() == 27) { stopReading = true; queue.close(); }
+
+            // Flush when the batch is full, or when the reader has gone quiet
+            if (staged >= BATCH || (staged > 0 && (!got || done))) {
+                s->executeUpdate("INSERT INTO TAP_STAGE (StudentID, CourseID, AttDate, Status) VALUES " + values + " ON DUPLICATE KEY UPDATE Status = IF(Status = 'Present', 'Present', VALUES(Status))");
+                conn->setAutoCommit(false);
+                updated += s->executeUpdate("UPDATE ATTENDANCE A JOIN TAP_STAGE T ON A.StudentID = T.StudentID AND A.CourseID = T.CourseID AND A.AttendanceDate >= T.AttDate AND A.AttendanceDate < T.AttDate + INTERVAL 1 DAY SET A.Status = IF(A.Status = 'Present', 'Present', T.Status)");
+                inserted += s->executeUpdate("INSERT INTO ATTENDANCE (StudentID, CourseID, AttendanceDate, Status) SELECT T.StudentID, T.CourseID, T.AttDate, T.Status FROM TAP_STAGE T JOIN STUDENT_COURSE SC ON SC.StudentID = T.StudentID AND SC.CourseID = T.CourseID WHERE NOT EXISTS (SELECT 1 FROM ATTENDANCE_ALL A WHERE A.StudentID = T.StudentID AND A.CourseID = T.CourseID AND A.AttendanceDate >= T.AttDate AND A.AttendanceDate < T.AttDate + INTERVAL 1 DAY)");
+                conn->commit();
+                conn->setAutoCommit(true);
+                committed = inserted + updated;
+                s->execute("DELETE FROM TAP_STAGE");
+                values.clear(); staged = 0;
+                if (seen.size() > SEEN_LIMIT) seen.clear();
+
+                double secs = secondsSince(start);
+                cout << "\r   Taps: " << accepted << "  Dupes: " << duplicates << "  Rate: " << (long long)(secs > 0 ? (accepted + duplicates) / secs : 0) << "/s" << (follow ? "  [ESC] Stop" : "") << "     " << flush;
+            }
+        }
+        s->execute("DROP TEMPORARY TABLE IF EXISTS TAP_STAGE");
+        delete s;
+    }
+    catch (sql::SQLException& e) {
+        failure = e.what();
+        try { conn->rollback(); } catch (...) {}
+        conn->setAutoCommit(true);
+    }
+    stopReading = true;
+    queue.close();
+    reader.join();
+    if (inserted + updated > 0) invalidateWindows(conn);
+    emitBulkJob("Ingest Card Taps", committed);
+
+    double secs = secondsSince(start);
+    cout << "\n";
+    if (!failure.empty()) drawError("Ingest stopped: " + failure);
+    else drawSuccess("Tap ingest finished.");
+    cout << "   Lines read:        " << linesRead << "  (bad: " << badLines << ")" << endl;
+    cout << "   Taps recorded:     " << accepted << "  (repeat taps dropped: " << duplicates << ")" << endl;
+    cout << "   ATTENDANCE rows:   " << inserted << " new, " << updated << " updated" << endl;
+    cout << "   Time:              " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:        " << (long long)(secs > 0 ? linesRead / secs : 0) << " taps/s" << endl;
+    cout << "   Queue peak:        " << queue.peakSize() << " / " << QUEUE_SIZE << "  (reader waited " << queue.fullWaitCount() << " times)" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// What STUDENT_FEE.Status should be for the given amounts
+string feeStatusFor(Money due, Money paid) {
+    if (paid >= due) return "Paid";
+    if (paid.cents > 0) return "Partial";
+    return "Unpaid";
+}
+
+// Checks that every STUDENT_FEE.AmountPaid equals the sum of its PAYMENT rows and that
+// Status matches the amounts. SFID ranges are handed out to worker threads, each with
+// its own connection; every chunk is a short autocommit read, so no locks are held
+// between chunks. Mismatches go to a CSV report and can optionally be fixed.
+void reconcileLedger(sql::Connection* conn) {
+    system("cls"); drawHeader("LEDGER RECONCILIATION", 13);
+    string threadStr = inputString("Worker Threads (default 4): ");
+    string repairStr = inputString("Repair mismatches? (Y/N): ");
+    string path = inputString("Report File (default reconcile_report.csv): ");
+    int workerCount = 4;
+    try { if (!threadStr.empty()) workerCount = stoi(threadStr); }
+    catch (...) {}
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > 16) workerCount = 16;
+    bool repair = (repairStr == "Y" || repairStr == "y");
+    if (path.empty()) path = "reconcile_report.csv";
+    if (repair && inputString("Type CONFIRM to repair while scanning: ") != "CONFIRM") return;
+
+    int lo = 0, hi = -1;
+    try {
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery("SELECT MIN(SFID), MAX(SFID) FROM STUDENT_FEE");
+        if (r->next() && !r->isNull(1)) { lo = r->getInt(1); hi = r->getInt(2); }
+        delete r; delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
+    if (hi < lo) { drawSuccess("STUDENT_FEE is empty, nothing to check."); (void)_getch(); return; }
+
+    FILE* report = fopen(path.c_str(), "w");
+    if (!report) { drawError("Cannot open " + path); (void)_getch(); return; }
+    fprintf(report, "SFID,StudentID,AmountDue,AmountPaid,PaymentTotal,Status,ExpectedStatus,Repaired\n");
+
+    const int CHUNK = 10000;                 // SFIDs per read
+    const int REPAIR_BATCH = 100;            // fixes per transaction
+    long long chunkCount = ((long long)hi - lo) / CHUNK + 1;
+    atomic<long long> nextChunk(0), chunksDone(0), feesChecked(0), mismatches(0), repaired(0);
+    atomic<bool> stopAll(false);
+    mutex reportLock;
+    string firstError;
+
+    string host, schema;
+    targetOf(conn, host, schema);
+
+    auto worker = [&]() {
+        sql::mysql::get_driver_instance()->threadInit();
+        sql::Connection* wc = nullptr;
+        try {
+            wc = openConnection(host, schema);
+            wc->setTransactionIsolation(sql::TRANSACTION_READ_COMMITTED);
+            sql::PreparedStatement* scan = wc->prepareStatement("SELECT SF.SFID, SF.StudentID, SF.AmountDue, SF.AmountPaid, SF.Status, COALESCE(P.Total, 0) FROM STUDENT_FEE SF LEFT JOIN (SELECT SFID, SUM(Amount) AS Total FROM PAYMENT_ALL WHERE SFID BETWEEN ? AND ? GROUP BY SFID) P ON P.SFID = SF.SFID WHERE SF.SFID BETWEEN ? AND ?");
+            // Only fix the row if nobody paid in the meantime (AmountPaid still what we saw)
+            sql::PreparedStatement* fix = wc->prepareStatement("UPDATE STUDENT_FEE SET AmountPaid = ?, Status = ? WHERE SFID = ? AND AmountPaid = ?");
+
+            while (true) {
+                long long c = nextChunk++;
+                if (c >= chunkCount || stopAll) break;
+                int from = lo + (int)(c * CHUNK);
+                int to = (hi - from < CHUNK) ? hi : from + CHUNK - 1;
+                scan->setInt(1, from); scan->setInt(2, to); scan->setInt(3, from); scan->setInt(4, to);
+                sql::ResultSet* r = scan->executeQuery();
+
+                struct Fix { int sfid; Money paid; string status; Money seenPaid; };
+                vector<Fix> fixes;
+                string lines;
+                long long checked = 0;
+                while (r->next()) {
+                    checked++;
+                    Money due = Money::fromColumn(r->getString(3));
+                    Money paid = Money::fromColumn(r->getString(4));
+                    string status = r->getString(5);
+                    Money ledger = Money::fromColumn(r->getString(6));
+                    string expected = feeStatusFor(due, ledger);
+                    if (paid == ledger && status == expected) continue;
+
+                    int sfid = r->getInt(1);
+                    lines += to_string(sfid) + "," + to_string(r->getInt(2)) + "," + due.toString() + "," + paid.toString() + "," + ledger.toString() + "," + status + "," + expected + "," + (repair ? "Y" : "N") + "\n";
+                    if (repair) fixes.push_back({ sfid, ledger, expected, paid });
+                }
+                delete r;
+
+                // Small transactions so payFees never waits long behind us
+                for (size_t i = 0; i < fixes.size(); i += REPAIR_BATCH) {
+                    wc->setAutoCommit(false);
+                    long long batchFixed = 0;
+                    for (size_t j = i; j < fixes.size() && j < i + REPAIR_BATCH; j++) {
+                        fix->setString(1, fixes[j].paid.toString());
+                        fix->setString(2, fixes[j].status);
+                        fix->setInt(3, fixes[j].sfid);
+                        fix->setString(4, fixes[j].seenPaid.toString());
+                        batchFixed += fix->executeUpdate();
+                    }
+                    wc->commit();
+                    wc->setAutoCommit(true);
+                    repaired += batchFixed;
+                }
+
+                if (!lines.empty()) {
+                    lock_guard<mutex> lock(reportLock);
+                    fputs(lines.c_str(), report);
+                }
+                mismatches += (long long)count(lines.begin(), lines.end(), '\n');
+                feesChecked += checked;
+                chunksDone++;
+            }
+            delete fix; delete scan;
+        }
+        catch (sql::SQLException& e) {
+            lock_guard<mutex> lock(reportLock);
+            if (firstError.empty()) firstError = e.what();
+            stopAll = true;
+            if (wc) { try { wc->rollback(); } catch (...) {} }
+        }
+        delete wc;
+        sql::mysql::get_driver_instance()->threadEnd();
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int i = 0; i < workerCount; i++) workers.emplace_back(worker);
+
+    cout << "\n";
+    while (chunksDone < chunkCount && !stopAll) {
+        cout << "\r   Chunks: " << chunksDone << "/" << chunkCount << "   Fees checked: " << feesChecked << "   Mismatches: " << mismatches << flush;
+        Sleep(250);
+    }
+    for (thread& t : workers) t.join();
+    fclose(report);
+
+    // Repairs change balances; re-age everyone once rather than from every worker
+    if (repaired > 0) {
+        try { conn->setAutoCommit(false); refreshAgingAll(conn); conn->commit(); }
+        catch (sql::SQLException& e) { conn->rollback(); if (firstError.empty()) firstError = "Debt aging refresh: " + string(e.what()); }
+        conn->setAutoCommit(true);
+    }
+    emitBulkJob("Reconcile Ledger", repaired);
+
+    double secs = secondsSince(start);
+    cout << "\r   Chunks: " << chunksDone << "/" << chunkCount << "   Fees checked: " << feesChecked << "   Mismatches: " << mismatches << endl;
+    if (!firstError.empty()) drawError("Reconciliation stopped: " + firstError);
+    else if (mismatches == 0) drawSuccess("Ledger is consistent.");
+    else drawError(to_string(mismatches) + " mismatches written to " + path);
+    if (repair) cout << "   Rows repaired:  " << repaired << endl;
+    cout << "   Time:           " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:     " << (long long)(secs > 0 ? feesChecked / secs : 0) << " fees/s on " << workerCount << " threads" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// Tables a student's history lives in, children first (that's the delete order)
+const int ARCHIVE_TABLE_COUNT = 8;
+const string ARCHIVE_TABLES[ARCHIVE_TABLE_COUNT] = { "PAYMENT_HISTORY", "PAYMENT", "BALANCE_CHECKPOINT", "ATTENDANCE_HISTORY", "ATTENDANCE", "STUDENT_FEE", "STUDENT_COURSE", "STUDENT" };
+
+// Creates <TABLE>_ARCHIVE copies and the job checkpoint tables on first use
+void ensureArchiveTables(sql::Connection* conn) {
+    sql::Statement* s = conn->createStatement();
+    for (int i = 0; i < ARCHIVE_TABLE_COUNT; i++) {
+        s->execute("CREATE TABLE IF NOT EXISTS " + ARCHIVE_TABLES[i] + "_ARCHIVE LIKE " + ARCHIVE_TABLES[i]);
+    }
+    s->execute("CREATE TABLE IF NOT EXISTS ARCHIVE_JOB (JobID INT AUTO_INCREMENT PRIMARY KEY, Description VARCHAR(100) NOT NULL, LastStudentID INT NOT NULL DEFAULT 0, StudentsDone INT NOT NULL DEFAULT 0, StudentsTotal INT NOT NULL DEFAULT 0, Status VARCHAR(10) NOT NULL DEFAULT 'Paused', CreatedAt TIMESTAMP DEFAULT CURRENT_TIMESTAMP, UpdatedAt TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP)");
+    s->execute("CREATE TABLE IF NOT EXISTS ARCHIVE_JOB_STUDENT (JobID INT NOT NULL, StudentID INT NOT NULL, PRIMARY KEY (JobID, StudentID))");
+    delete s;
+}
+
+// Snapshots the cohort into ARCHIVE_JOB_STUDENT so the job can resume later even
+// though its STUDENT_COURSE rows are being deleted. Returns the new JobID or -1.
+int createArchiveJob(sql::Connection* conn) {
+    string who = inputString("Archive (1 = Students in a Course, 2 = StudentID Range): ");
+    string desc, cohortQ;
+    int courseID = -1, fromID = 0, toID = 0;
+    if (who == "1") {
+        string cname; Money dummy;
+        if (!selectCourse(conn, courseID, cname, dummy)) { (void)_getch(); return -1; }
+        desc = "Course " + cname;
+    }
+    else if (who == "2") {
+        try {
+            fromID = stoi(inputString("From StudentID: "));
+            toID = stoi(inputString("To StudentID:   "));
+        }
+        catch (...) { drawError("Invalid input."); (void)_getch(); return -1; }
+        desc = "Students " + to_string(fromID) + "-" + to_string(toID);
+    }
+    else return -1;
+
+    int jobID = -1;
+    try {
+        conn->setAutoCommit(false);
+        sql::PreparedStatement* p = conn->prepareStatement("INSERT INTO ARCHIVE_JOB (Description) VALUES (?)");
+        p->setString(1, desc); p->executeUpdate(); delete p;
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery("SELECT LAST_INSERT_ID()");
+        if (r->next()) jobID = r->getInt(1);
+        delete r; delete s;
+
+        sql::PreparedStatement* fill;
+        if (courseID != -1) {
+            fill = conn->prepareStatement("INSERT INTO ARCHIVE_JOB_STUDENT (JobID, StudentID) SELECT DISTINCT ?, StudentID FROM STUDENT_COURSE WHERE CourseID = ?");
+            fill->setInt(1, jobID); fill->setInt(2, courseID);
+        }
+        else {
+            fill = conn->prepareStatement("INSERT INTO ARCHIVE_JOB_STUDENT (JobID, StudentID) SELECT ?, StudentID FROM STUDENT WHERE StudentID BETWEEN ? AND ?");
+            fill->setInt(1, jobID); fill->setInt(2, fromID); fill->setInt(3, toID);
+        }
+        int total = fill->executeUpdate(); delete fill;
+
+        sql::PreparedStatement* upd = conn->prepareStatement("UPDATE ARCHIVE_JOB SET StudentsTotal = ? WHERE JobID = ?");
+        upd->setInt(1, total); upd->setInt(2, jobID); upd->executeUpdate(); delete upd;
+        conn->commit();
+    }
+    catch (sql::SQLException& e) { conn->rollback(); drawError(e.what()); jobID = -1; (void)_getch(); }
+    conn->setAutoCommit(true);
+    return jobID;
+}
+
+// Lists unfinished jobs and lets the admin pick one. Returns JobID or -1.
+int pickArchiveJob(sql::Connection* conn) {
+    system("cls"); drawHeader("UNFINISHED ARCHIVE JOBS", 11);
+    int ids[MAX_ITEMS];
+    int count = 0;
+    try {
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery("SELECT JobID, Description, StudentsDone, StudentsTotal, UpdatedAt FROM ARCHIVE_JOB WHERE Status <> 'Done' ORDER BY JobID");
+        cout << "\n   " << left << setw(6) << "Job" << setw(30) << "Cohort" << setw(16) << "Progress" << "Last Run" << endl;
+        cout << "   " << string(75, '-') << endl;
+        while (r->next()) {
+            if (count >= MAX_ITEMS) break;
+            ids[count++] = r->getInt(1);
+            string desc = r->getString(2);
+            cout << "   " << left << setw(6) << r->getInt(1) << setw(30) << desc.substr(0, 28) << setw(16) << (to_string(r->getInt(3)) + "/" + to_string(r->getInt(4))) << r->getString(5) << endl;
+        }
+        delete r; delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return -1; }
+    if (count == 0) { drawSuccess("No unfinished jobs."); (void)_getch(); return -1; }
+
+    string idStr = inputString("\nEnter Job #: ");
+    try {
+        int id = stoi(idStr);
+        for (int i = 0; i < count; i++) if (ids[i] == id) return id;
+    }
+    catch (...) {}
+    drawError("Invalid Job."); (void)_getch(); return -1;
+}
+
+// Moves a cohort's STUDENT rows and all their history into the *_ARCHIVE tables.
+// Work is done in StudentID order, BATCH students per transaction (copy + delete +
+// checkpoint commit together), with a pause between batches so payments and roll
+// calls keep getting the locks. ESC pauses the job; it can be resumed later.
+void archiveStudents(sql::Connection* conn) {
+    system("cls"); drawHeader("ARCHIVE GRADUATED STUDENTS", 13);
+    try { ensureArchiveTables(conn); }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
+
+    string mode = inputString("(1 = New Job, 2 = Resume Job): ");
+    int jobID = -1;
+    if (mode == "1") jobID = createArchiveJob(conn);
+    else if (mode == "2") jobID = pickArchiveJob(conn);
+    if (jobID == -1) return;
+
+    string pauseStr = inputString("Pause between batches in ms (default 200): ");
+    int pauseMs = 200;
+    try { if (!pauseStr.empty()) pauseMs = stoi(pauseStr); }
+    catch (...) {}
+    if (inputString("Type CONFIRM to start archiving: ") != "CONFIRM") return;
+
+    const int BATCH = 50; // students per transaction
+    long long moved[ARCHIVE_TABLE_COUNT] = {};
+    int lastID = 0, done = 0, total = 0;
+    bool paused = false;
+    string failure;
+    auto start = chrono::steady_clock::now();
+    int startDone = 0;
+
+    try {
+        sql::PreparedStatement* job = conn->prepareStatement("SELECT LastStudentID, StudentsDone, StudentsTotal FROM ARCHIVE_JOB WHERE JobID = ?");
+        job->setInt(1, jobID);
+        sql::ResultSet* jr = job->executeQuery();
+        if (jr->next()) { lastID = jr->getInt(1); done = jr->getInt(2); total = jr->getInt(3); }
+        delete jr; delete job;
+        startDone = done;
+
+        sql::PreparedStatement* setStatus = conn->prepareStatement("UPDATE ARCHIVE_JOB SET Status = ? WHERE JobID = ?");
+        setStatus->setString(1, "Running"); setStatus->setInt(2, jobID); setStatus->executeUpdate();
+
+        sql::PreparedStatement* nextBatch = conn->prepareStatement("SELECT MAX(StudentID), COUNT(*) FROM (SELECT StudentID FROM ARCHIVE_JOB_STUDENT WHERE JobID = ? AND StudentID > ? ORDER BY StudentID LIMIT " + to_string(BATCH) + ") T");
+        string inBatch = " WHERE StudentID IN (SELECT StudentID FROM ARCHIVE_JOB_STUDENT WHERE JobID = ? AND StudentID > ? AND StudentID <= ?)";
+        sql::PreparedStatement* copies[ARCHIVE_TABLE_COUNT];
+        sql::PreparedStatement* deletes[ARCHIVE_TABLE_COUNT];
+        for (int t = 0; t < ARCHIVE_TABLE_COUNT; t++) {
+            copies[t] = conn->prepareStatement("INSERT IGNORE INTO " + ARCHIVE_TABLES[t] + "_ARCHIVE SELECT * FROM " + ARCHIVE_TABLES[t] + inBatch);
+            deletes[t] = conn->prepareStatement("DELETE FROM " + ARCHIVE_TABLES[t] + inBatch);
+        }
+        sql::PreparedStatement* checkpoint = conn->prepareStatement("UPDATE ARCHIVE_JOB SET LastStudentID = ?, StudentsDone = StudentsDone + ? WHERE JobID = ?");
+        sql::PreparedStatement* releaseSeats = conn->prepareStatement("UPDATE COURSE C JOIN (SELECT CourseID, COUNT(*) AS N FROM STUDENT_COURSE" + inBatch + " GROUP BY CourseID) X ON X.CourseID = C.CourseID SET C.SeatsTaken = GREATEST(C.SeatsTaken - X.N, 0)");
+        sql::PreparedStatement* dropWaits = conn->prepareStatement("DELETE FROM WAITLIST" + inBatch);
+        sql::PreparedStatement* seatCourses = conn->prepareStatement("SELECT DISTINCT CourseID FROM STUDENT_COURSE" + inBatch);
+
+        cout << "\n";
+        while (true) {
+            nextBatch->setInt(1, jobID); nextBatch->setInt(2, lastID);
+            sql::ResultSet* br = nextBatch->executeQuery();
+            int batchMax = -1, batchSize = 0;
+            if (br->next() && !br->isNull(1)) { batchMax = br->getInt(1); batchSize = br->getInt(2); }
+            delete br;
+            if (batchSize == 0) break;
+
+            conn->setAutoCommit(false);
+            // Give back the graduates' seats before their enrollments leave
+            vector<int> freed;
+            seatCourses->setInt(1, jobID); seatCourses->setInt(2, lastID); seatCourses->setInt(3, batchMax);
+            sql::ResultSet* fr = seatCourses->executeQuery();
+            while (fr->next()) freed.push_back(fr->getInt(1));
+            delete fr;
+            releaseSeats->setInt(1, jobID); releaseSeats->setInt(2, lastID); releaseSeats->setInt(3, batchMax);
+            releaseSeats->executeUpdate();
+            dropWaits->setInt(1, jobID); dropWaits->setInt(2, lastID); dropWaits->setInt(3, batchMax);
+            dropWaits->executeUpdate();
+            for (int t = 0; t < ARCHIVE_TABLE_COUNT; t++) {
+                copies[t]->setInt(1, jobID); copies[t]->setInt(2, lastID); copies[t]->setInt(3, batchMax);
+                copies[t]->executeUpdate();
+                deletes[t]->setInt(1, jobID); deletes[t]->setInt(2, lastID); deletes[t]->setInt(3, batchMax);
+                moved[t] += deletes[t]->executeUpdate();
+            }
+            // The freed seats go to the head of each course's waitlist
+            for (int cid : freed) promoteWaitlist(conn, cid);
+            refreshAging(conn, "StudentID IN (SELECT StudentID FROM ARCHIVE_JOB_STUDENT WHERE JobID = ? AND StudentID > ? AND StudentID <= ?)", { to_string(jobID), to_string(lastID), to_string(batchMax) });
+            checkpoint->setInt(1, batchMax); checkpoint->setInt(2, batchSize); checkpoint->setInt(3, jobID);
+            checkpoint->executeUpdate();
+            conn->commit();
+            conn->setAutoCommit(true);
+
+            lastID = batchMax;
+            done += batchSize;
+            double secs = secondsSince(start);
+            cout << "\r   Students: " << done << "/" << total << "   Rate: " << (long long)(secs > 0 ? (done - startDone) / secs : 0) << "/s   [ESC] Pause     " << flush;
+
+            if (_kbhit() && _getch() == 27) { paused = true; break; }
+            if (pauseMs > 0) Sleep(pauseMs);
+        }
+
+        setStatus->setString(1, paused ? "Paused" : "Done"); setStatus->setInt(2, jobID); setStatus->executeUpdate();
+        for (int t = 0; t < ARCHIVE_TABLE_COUNT; t++) { delete copies[t]; delete deletes[t]; }
+        delete checkpoint; delete nextBatch; delete setStatus; delete releaseSeats; delete dropWaits; delete seatCourses;
+    }
+    catch (sql::SQLException& e) {
+        failure = e.what();
+        try { conn->rollback(); } catch (...) {}
+        conn->setAutoCommit(true);
+    }
+    emitBulkJob("Archive Graduates", done - startDone, jobID);
+
+    double secs = secondsSince(start);
+    cout << "\n";
+    if (!failure.empty()) drawError("Stopped (resume later from the last checkpoint): " + failure);
+    else if (paused) drawSuccess("Job " + to_string(jobID) + " paused. Resume it any time.");
+    else drawSuccess("Job " + to_string(jobID) + " finished.");
+    cout << "   Students archived:   " << done << "/" << total << endl;
+    for (int t = 0; t < ARCHIVE_TABLE_COUNT; t++) cout << "   " << left << setw(21) << (ARCHIVE_TABLES[t] + ":") << moved[t] << " rows" << endl;
+    cout << "   Time:                " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// ---- Balance checkpoints ----
+// BALANCE_CHECKPOINT keeps each student's running totals as of the start of every
+// term (terms are 4-month blocks: Jan, May, Sep). A statement or "balance as of X"
+// then reads one checkpoint plus the fees and payments since it, not the whole history.
+// The checkpoint for a term is written by the student's first payment in it.
+
+// First day of the term 'date' falls in, as YYYY-MM-DD
+string termStart(const string& date) {
+    int month = atoi(date.c_str() + 5);
+    int first = ((month - 1) / TERM_MONTHS) * TERM_MONTHS + 1;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.4s-%02d-01", date.c_str(), first);
+    return buf;
+}
+
+// Writes this term's checkpoint for the student if it isn't there yet. Must run in the
+// payment's transaction, before the payment row is inserted.
+void writeBalanceCheckpoint(sql::Connection* conn, int studentID) {
+    time_t t = time(0); char buf[16]; strftime(buf, sizeof(buf), "%Y-%m-%d", localtime(&t));
+    string asOf = termStart(buf);
+
+    sql::PreparedStatement* last = conn->prepareStatement("SELECT AsOf, TotalPaid, PaymentCount FROM BALANCE_CHECKPOINT WHERE StudentID = ? ORDER BY AsOf DESC LIMIT 1 FOR UPDATE");
+    last->setInt(1, studentID);
+    sql::ResultSet* lr = last->executeQuery();
+    string prevAsOf = "1000-01-01";
+    Money paid; int count = 0;
+    if (lr->next()) { prevAsOf = lr->getString(1); paid = Money::fromColumn(lr->getString(2)); count = lr->getInt(3); }
+    delete lr; delete last;
+    if (prevAsOf >= asOf) return; // already written this term
+
+    // Roll the previous checkpoint forward by the payments made since it
+    sql::PreparedStatement* since = conn->prepareStatement("SELECT COALESCE(SUM(Amount), 0), COUNT(*) FROM PAYMENT_ALL WHERE StudentID = ? AND PaymentDate >= ? AND PaymentDate < ?");
+    since->setInt(1, studentID); since->setString(2, prevAsOf); since->setString(3, asOf);
+    sql::ResultSet* sr = since->executeQuery();
+    if (sr->next()) { paid += Money::fromColumn(sr->getString(1)); count += sr->getInt(2); }
+    delete sr; delete since;
+
+    // Only fees billed before the term started, so both totals stop at AsOf
+    sql::PreparedStatement* ins = conn->prepareStatement("INSERT IGNORE INTO BALANCE_CHECKPOINT (StudentID, AsOf, TotalDue, TotalPaid, PaymentCount) SELECT ?, ?, COALESCE(SUM(AmountDue), 0), ?, ? FROM STUDENT_FEE WHERE StudentID = ? AND BilledAt < ?");
+    ins->setInt(1, studentID); ins->setString(2, asOf); ins->setString(3, paid.toString()); ins->setInt(4, count); ins->setInt(5, studentID); ins->setString(6, asOf);
+    ins->executeUpdate();
+    delete ins;
+}
+
+// Auditor view: what a student had been billed and had paid by the end of a given day
+void showBalanceAsOf(sql::Connection* conn) {
+    system("cls"); drawHeader("BALANCE AS OF DATE", 13);
+    string sidStr = inputString("Student ID: ");
+    string date = inputString("As of (YYYY-MM-DD): ");
+    if (sidStr.empty() || !isValidDate(date)) { drawError("Enter a Student ID and a YYYY-MM-DD date."); (void)_getch(); return; }
+    int sid = atoi(sidStr.c_str());
+
+    try {
+        auto start = chrono::steady_clock::now();
+        sql::PreparedStatement* cp = conn->prepareStatement("SELECT AsOf, TotalDue, TotalPaid, PaymentCount FROM BALANCE_CHECKPOINT WHERE StudentID = ? AND AsOf <= ? ORDER BY AsOf DESC LIMIT 1");
+        cp->setInt(1, sid); cp->setString(2, date);
+        sql::ResultSet* cr = cp->executeQuery();
+        bool hasCheckpoint = cr->next();
+        string from = hasCheckpoint ? cr->getString(1) : "1000-01-01";
+        Money due = hasCheckpoint ? Money::fromColumn(cr->getString(2)) : Money();
+        Money paidAtCheckpoint = hasCheckpoint ? Money::fromColumn(cr->getString(3)) : Money();
+        int countAtCheckpoint = hasCheckpoint ? cr->getInt(4) : 0;
+        delete cr; delete cp;
+
+        // Fees billed after the checkpoint, up to the end of the day
+        sql::PreparedStatement* d = conn->prepareStatement("SELECT COALESCE(SUM(AmountDue), 0) FROM STUDENT_FEE WHERE StudentID = ? AND BilledAt >= ? AND BilledAt < DATE_ADD(?, INTERVAL 1 DAY)");
+        d->setInt(1, sid); d->setString(2, from); d->setString(3, date);
+        sql::ResultSet* dr = d->executeQuery();
+        if (dr->next()) due += Money::fromColumn(dr->getString(1));
+        delete dr; delete d;
+
+        sql::PreparedStatement* p = conn->prepareStatement("SELECT COALESCE(SUM(Amount), 0), COUNT(*) FROM PAYMENT_ALL WHERE StudentID = ? AND PaymentDate >= ? AND PaymentDate < DATE_ADD(?, INTERVAL 1 DAY)");
+        p->setInt(1, sid); p->setString(2, from); p->setString(3, date);
+        sql::ResultSet* pr = p->executeQuery();
+        Money paidSince; int countSince = 0;
+        if (pr->next()) { paidSince = Money::fromColumn(pr->getString(1)); countSince = pr->getInt(2); }
+        delete pr; delete p;
+        double ms = secondsSince(start) * 1000.0;
+
+        Money paid = paidAtCheckpoint + paidSince;
+        cout << "\n   Checkpoint used:   " << (hasCheckpoint ? from : string("none (full history read)")) << endl;
+        cout << "   Billed by " << date << ": $" << due.toString() << endl;
+        cout << "   Paid by " << date << ": $" << paid.toString() << "  (" << countAtCheckpoint + countSince << " payments)" << endl;
+        cout << "   Balance:           "; setColor((due - paid).cents > 0 ? 12 : 10); cout << "$" << (due - paid).toString() << endl; setColor(7);
+        setColor(8); cout << "\n   Read " << countSince << " payments after the checkpoint in " << fixed << setprecision(1) << ms << " ms" << endl; setColor(7);
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); }
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// ---- Term tiering ----
+// ATTENDANCE and PAYMENT keep only the current and the previous term (two terms, so the
+// 16-week attendance windows never reach past them). Older terms are moved into
+// ATTENDANCE_HISTORY / PAYMENT_HISTORY: compressed tables with one range partition per
+// term. They have no foreign keys, since MySQL can't partition tables that have them.
+// Student screens read the current term from the hot tables; "include history" and
+// whole-lifetime reports read the ATTENDANCE_ALL / PAYMENT_ALL views.
+const int HOT_TERMS = 2;
+const int TIER_CHUNK_DAYS = 7; // one transaction per week of rows
+
+struct TierTable { string hot, history, dateColumn, columns; };
+const int TIER_TABLE_COUNT = 2;
+const TierTable TIER_TABLES[TIER_TABLE_COUNT] = {
+    { "ATTENDANCE", "ATTENDANCE_HISTORY", "AttendanceDate", "AttendanceID, StudentID, CourseID, AttendanceDate, Status" },
+    { "PAYMENT", "PAYMENT_HISTORY", "PaymentDate", "StudentID, SFID, Amount, PaymentDate, TransactionRef" }
+};
+
+// Start of the term 'terms' terms after (negative: before) the one starting on 'start'
+string addTerms(const string& start, int terms) {
+    int months = atoi(start.c_str()) * 12 + atoi(start.c_str() + 5) - 1 + terms * TERM_MONTHS;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d-%02d-01", months / 12, months % 12 + 1);
+    return buf;
+}
+
+// Gives 'history' a partition ending at termEnd. New partitions are split off the
+// open-ended p_open, so they only go on the end; a term older than the newest
+// partition already falls into one.
+void ensureTermPartition(sql::Connection* conn, const string& history, const string& term, const string& termEnd) {
+    sql::PreparedStatement* p = conn->prepareStatement("SELECT MAX(PARTITION_DESCRIPTION) FROM INFORMATION_SCHEMA.PARTITIONS WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND PARTITION_NAME <> 'p_open'");
+    p->setString(1, history);
+    sql::ResultSet* r = p->executeQuery();
+    string newest = (r->next() && !r->isNull(1)) ? r->getString(1) : "";
+    delete r; delete p;
+    if (newest >= "'" + termEnd + "'") return;
+
+    string name = "p" + term.substr(0, 4) + term.substr(5, 2);
+    sql::Statement* s = conn->createStatement();
+    s->execute("ALTER TABLE " + history + " REORGANIZE PARTITION p_open INTO (PARTITION " + name + " VALUES LESS THAN ('" + termEnd + "'), PARTITION p_open VALUES LESS THAN (MAXVALUE))");
+    delete s;
+}
+
+// Moves every term before the hot window into the history tables, oldest first.
+// Copy + delete run together a week of rows at a time, so a stop part way loses nothing
+// and running it again carries on.
+void tierClosedTerms(sql::Connection* conn) {
+    system("cls"); drawHeader("TIER CLOSED TERMS", 13);
+    time_t t = time(0); char buf[16]; strftime(buf, sizeof(buf), "%Y-%m-%d", localtime(&t));
+    string cutoff = addTerms(termStart(buf), 1 - HOT_TERMS); // first day that stays hot
+
+    string oldest = cutoff;
+    try {
+        sql::Statement* s = conn->createStatement();
+        for (int i = 0; i < TIER_TABLE_COUNT; i++) {
+            sql::ResultSet* r = s->executeQuery("SELECT DATE(MIN(" + TIER_TABLES[i].dateColumn + ")) FROM " + TIER_TABLES[i].hot);
+            if (r->next() && !r->isNull(1) && r->getString(1) < oldest) oldest = r->getString(1);
+            delete r;
+        }
+        delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
+    if (oldest >= cutoff) { drawSuccess("Nothing to move. The hot tables only hold terms since " + cutoff + "."); (void)_getch(); return; }
+
+    cout << "\n   Terms from " << termStart(oldest) << " up to " << cutoff << " move into the history tables.\n";
+    if (inputString("   Type CONFIRM to start: ") != "CONFIRM") return;
+
+    long long moved[TIER_TABLE_COUNT] = {}, committed = 0;
+    int terms = 0;
+    string failure;
+    auto start = chrono::steady_clock::now();
+    try {
+        sql::PreparedStatement* copies[TIER_TABLE_COUNT];
+        sql::PreparedStatement* deletes[TIER_TABLE_COUNT];
+        for (int i = 0; i < TIER_TABLE_COUNT; i++) {
+            const TierTable& tt = TIER_TABLES[i];
+            string range = " WHERE " + tt.dateColumn + " >= ? AND " + tt.dateColumn + " < ?";
+            copies[i] = conn->prepareStatement("INSERT INTO " + tt.history + " (" + tt.columns + ") SELECT " + tt.columns + " FROM " + tt.hot + range);
+            deletes[i] = conn->prepareStatement("DELETE FROM " + tt.hot + range);
+        }
+
+        cout << "\n";
+        for (string term = termStart(oldest); term < cutoff; term = addTerms(term, 1)) {
+            string termEnd = addTerms(term, 1);
+            for (int i = 0; i < TIER_TABLE_COUNT; i++) ensureTermPartition(conn, TIER_TABLES[i].history, term, termEnd); // DDL, outside the transactions
+
+            int lastDay = dayNumber(termEnd);
+            for (int day = dayNumber(term); day < lastDay; day += TIER_CHUNK_DAYS) {
+                string from = dateOfDay(day), to = dateOfDay(min(day + TIER_CHUNK_DAYS, lastDay));
+                conn->setAutoCommit(false);
+                long long chunkRows = 0;
+                for (int i = 0; i < TIER_TABLE_COUNT; i++) {
+                    copies[i]->setString(1, from); copies[i]->setString(2, to);
+                    copies[i]->executeUpdate();
+                    deletes[i]->setString(1, from); deletes[i]->setString(2, to);
+                    int n = deletes[i]->executeUpdate();
+                    moved[i] += n; chunkRows += n;
+                }
+                conn->commit();
+                conn->setAutoCommit(true);
+                committed += chunkRows;
+            }
+            terms++;
+            cout << "\r   Term " << term << " done   Attendance: " << moved[0] << "   Payments: " << moved[1] << "     " << flush;
+        }
+        for (int i = 0; i < TIER_TABLE_COUNT; i++) { delete copies[i]; delete deletes[i]; }
+    }
+    catch (sql::SQLException& e) {
+        failure = e.what();
+        try { conn->rollback(); } catch (...) {}
+        conn->setAutoCommit(true);
+    }
+    emitBulkJob("Tier Closed Terms", committed);
+
+    cout << "\n";
+    if (!failure.empty()) drawError("Stopped (run it again to carry on): " + failure);
+    else drawSuccess("Closed terms moved to history.");
+    cout << "   Terms moved:         " << terms << endl;
+    for (int i = 0; i < TIER_TABLE_COUNT; i++) cout << "   " << left << setw(21) << (TIER_TABLES[i].history + ":") << moved[i] << " rows" << endl;
+    cout << "   Time:                " << fixed << setprecision(2) << secondsSince(start) << " s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// ---- Debt aging ----
+// DEBT_AGING holds each debtor's outstanding amount split by how long ago the fee
+// was billed. Every write re-ages only the students it touched, and a daily sweep
+// re-ages students whose fees crossed 30/60/90 days, so the aging report never scans
+// the ledger. There is no shared totals row: the report sums the rows it reads, so
+// writers only ever lock their own students' rows.
+
+// Re-ages the students matching 'filter', a condition on StudentID whose '?'s are
+// bound from params. Runs in the caller's transaction. Returns how many of those
+// students still owe something.
+int refreshAging(sql::Connection* conn, const string& filter, const vector<string>& params) {
+    sql::PreparedStatement* del = conn->prepareStatement("DELETE FROM DEBT_AGING WHERE (" + filter + ")");
+    for (size_t i = 0; i < params.size(); i++) del->setString((unsigned int)i + 1, params[i]);
+    del->executeUpdate();
+    delete del;
+
+    string owed = "AmountDue - AmountPaid";
+    sql::PreparedStatement* ins = conn->prepareStatement(
+        "INSERT INTO DEBT_AGING (StudentID, Days0_30, Days31_60, Days61_90, Days90Plus) SELECT StudentID, "
+        "SUM(CASE WHEN DATEDIFF(CURDATE(), BilledAt) <= 30 THEN " + owed + " ELSE 0 END), "
+        "SUM(CASE WHEN DATEDIFF(CURDATE(), BilledAt) BETWEEN 31 AND 60 THEN " + owed + " ELSE 0 END), "
+        "SUM(CASE WHEN DATEDIFF(CURDATE(), BilledAt) BETWEEN 61 AND 90 THEN " + owed + " ELSE 0 END), "
+        "SUM(CASE WHEN DATEDIFF(CURDATE(), BilledAt) > 90 THEN " + owed + " ELSE 0 END) "
+        "FROM STUDENT_FEE WHERE Status <> 'Paid' AND (" + filter + ") GROUP BY StudentID HAVING SUM(" + owed + ") <> 0");
+    for (size_t i = 0; i < params.size(); i++) ins->setString((unsigned int)i + 1, params[i]);
+    int debtors = ins->executeUpdate();
+    delete ins;
+    return debtors;
+}
+
+// Re-ages every student (the first sweep, and after ledger repairs). Runs in the
+// caller's transaction.
+int refreshAgingAll(sql::Connection* conn) {
+    return refreshAging(conn, "1 = 1", {});
+}
+
+// Runs at most once a day per database: re-ages the students with an unpaid fee that
+// crossed 30, 60 or 90 days since the last sweep, or that was billed since then outside
+// this program (the enrollment trigger). The first sweep ages everyone.
+// Returns how many students were re-aged, 0 if the sweep already ran today.
+int sweepAging(sql::Connection* conn) {
+    int swept = 0;
+    conn->setAutoCommit(false);
+    try {
+        // The row lock makes other PCs wait here and then see the sweep as done
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery("SELECT LastSweep, LastSweep IS NULL OR LastSweep < CURDATE() FROM AGING_STATE WHERE ID = 1 FOR UPDATE");
+        bool due = false, first = false;
+        string last;
+        if (r->next()) { first = r->isNull(1); last = first ? "" : r->getString(1); due = r->getInt(2) == 1; }
+        delete r;
+
+        if (due) {
+            if (first) swept = refreshAgingAll(conn);
+            else {
+                string crossed = "StudentID IN (SELECT StudentID FROM STUDENT_FEE WHERE Status <> 'Paid' AND (BilledAt >= ?";
+                for (int days : { 30, 60, 90 }) {
+                    crossed += " OR (BilledAt >= DATE_SUB(?, INTERVAL " + to_string(days) + " DAY) AND BilledAt < CURDATE() - INTERVAL " + to_string(days) + " DAY)";
+                }
+                swept = refreshAging(conn, crossed + "))", { last, last, last, last });
+            }
+            s->executeUpdate("UPDATE AGING_STATE SET LastSweep = CURDATE() WHERE ID = 1");
+        }
+        delete s;
+        conn->commit();
+    }
+    catch (sql::SQLException&) { conn->rollback(); conn->setAutoCommit(true); throw; }
+    conn->setAutoCommit(true);
+    return swept;
+}
+
+// Sweeps the main database, or every campus
+void sweepAgingAll(sql::Connection* conn) {
+    try {
+        if (dbConfig.shardCount == 0) sweepAging(conn);
+        for (int i = 0; i < dbConfig.shardCount; i++) {
+            if (shardConnection(i)) sweepAging(shardConnection(i));
+        }
+    }
+    catch (sql::SQLException& e) { drawError("Debt aging sweep failed: " + string(e.what())); }
+}
+
+// Enrolls whole cohorts in next term's courses. The mapping file has one line per
+// course: "FromCourseID,ToCourseID[,ToCourseID...]" ('#' starts a comment). Every
+// student in a From course is enrolled in its To courses with set-based inserts,
+// one transaction per StudentID range. Existing enrollments are skipped, so a
+// rollover that stopped half way can simply be run again.
+void termRollover(sql::Connection* conn) {
+    system("cls"); drawHeader("TERM ROLLOVER", 13);
+    cout << "   Mapping format: FromCourseID,ToCourseID[,ToCourseID...] (one course per line)\n\n";
+    string path = inputString("Mapping File: ");
+    if (path.empty()) return;
+    ifstream in(path);
+    if (!in) { drawError("Cannot open " + path); (void)_getch(); return; }
+
+    vector<pair<int, int>> pairs;
+    string line;
+    int lineNo = 0;
+    while (getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        vector<int> ids;
+        size_t pos = 0;
+        bool bad = false;
+        while (pos <= line.size()) {
+            size_t comma = line.find(',', pos);
+            string part = line.substr(pos, comma == string::npos ? string::npos : comma - pos);
+            char* end;
+            long v = strtol(part.c_str(), &end, 10);
+            while (*end == ' ' || *end == '\t' || *end == '\r') end++;
+            if (*end != '\0' || v <= 0) { bad = true; break; }
+            ids.push_back((int)v);
+            if (comma == string::npos) break;
+            pos = comma + 1;
+        }
+        if (bad || ids.size() < 2) { drawError("Line " + to_string(lineNo) + " is not FromCourseID,ToCourseID[,...]"); (void)_getch(); return; }
+        for (size_t i = 1; i < ids.size(); i++) pairs.push_back({ ids[0], ids[i] });
+    }
+    if (pairs.empty()) { drawError("The mapping file is empty."); (void)_getch(); return; }
+
+    const int CHUNK = 5000; // StudentIDs per transaction
+    long long enrolled = 0, candidates = 0, committed = 0;
+    int lo = 0, hi = -1;
+    try {
+        sql::Statement* s = conn->createStatement();
+        s->execute("CREATE TEMPORARY TABLE IF NOT EXISTS ROLLOVER_MAP (FromCourseID INT NOT NULL, ToCourseID INT NOT NULL, PRIMARY KEY (FromCourseID, ToCourseID)) ENGINE=MEMORY");
+        s->execute("DELETE FROM ROLLOVER_MAP");
+        string values;
+        for (size_t i = 0; i < pairs.size(); i++) values += (i ? "," : "") + string("(") + to_string(pairs[i].first) + "," + to_string(pairs[i].second) + ")";
+        s->executeUpdate("INSERT IGNORE INTO ROLLOVER_MAP (FromCourseID, ToCourseID) VALUES " + values);
+
+        // Preview: every mapping line with its course names and cohort size
+        sql::ResultSet* r = s->executeQuery("SELECT M.FromCourseID, CF.CourseName, M.ToCourseID, CT.CourseName, (SELECT COUNT(*) FROM STUDENT_COURSE SC WHERE SC.CourseID = M.FromCourseID) FROM ROLLOVER_MAP M LEFT JOIN COURSE CF ON CF.CourseID = M.FromCourseID LEFT JOIN COURSE CT ON CT.CourseID = M.ToCourseID ORDER BY M.FromCourseID, M.ToCourseID");
+        bool unknown = false;
+        cout << "\n   " << left << setw(32) << "From" << setw(32) << "To" << "Students" << endl;
+        cout << "   " << string(72, '-') << endl;
+        while (r->next()) {
+            string from = r->isNull(2) ? "?? unknown course" : r->getString(2);
+            string to = r->isNull(4) ? "?? unknown course" : r->getString(4);
+            if (r->isNull(2) || r->isNull(4)) unknown = true;
+            cout << "   " << left << setw(32) << ("[" + to_string(r->getInt(1)) + "] " + from).substr(0, 30) << setw(32) << ("[" + to_string(r->getInt(3)) + "] " + to).substr(0, 30) << r->getInt(5) << endl;
+        }
+        delete r;
+        if (unknown) { delete s; drawError("The mapping names courses that don't exist."); (void)_getch(); return; }
+
+        r = s->executeQuery("SELECT COUNT(*), MIN(T.StudentID), MAX(T.StudentID) FROM (SELECT DISTINCT SC.StudentID, M.ToCourseID FROM STUDENT_COURSE SC JOIN ROLLOVER_MAP M ON M.FromCourseID = SC.CourseID) T");
+        if (r->next() && !r->isNull(2)) { candidates = r->getInt64(1); lo = r->getInt(2); hi = r->getInt(3); }
+        delete r; delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
+
+    if (hi < lo) { drawError("Nobody is enrolled in the From courses."); (void)_getch(); return; }
+    cout << "\n   Enrollments to create (before skipping existing ones): " << candidates << "\n\n";
+    if (inputString("Type CONFIRM to start the rollover: ") != "CONFIRM") return;
+
+    auto start = chrono::steady_clock::now();
+    string failure;
+    sql::PreparedStatement* ins = nullptr;
+    try {
+        ins = conn->prepareStatement(
+            "INSERT INTO STUDENT_COURSE (StudentID, CourseID) SELECT DISTINCT SC.StudentID, M.ToCourseID FROM STUDENT_COURSE SC JOIN ROLLOVER_MAP M ON M.FromCourseID = SC.CourseID "
+            "WHERE SC.StudentID BETWEEN ? AND ? AND NOT EXISTS (SELECT 1 FROM STUDENT_COURSE X WHERE X.StudentID = SC.StudentID AND X.CourseID = M.ToCourseID)");
+        conn->setAutoCommit(false);
+        for (int from = lo; from <= hi; from += CHUNK) {
+            int to = (hi - from < CHUNK) ? hi : from + CHUNK - 1;
+            ins->setInt(1, from);
+            ins->setInt(2, to);
+            enrolled += ins->executeUpdate();
+            refreshAging(conn, "StudentID BETWEEN ? AND ?", { to_string(from), to_string(to) }); // tuition billed by the enrollment trigger
+            conn->commit();
+            committed = enrolled;
+
+            double pct = (hi == lo) ? 100.0 : (to - lo + 1) * 100.0 / (hi - lo + 1);
+            double secs = secondsSince(start);
+            cout << "\r   Progress: " << fixed << setprecision(1) << setw(5) << pct << "%   Enrolled: " << enrolled << "   Rate: " << (long long)(secs > 0 ? enrolled / secs : 0) << "/s   " << flush;
+        }
+    }
+    catch (sql::SQLException& e) { try { conn->rollback(); } catch (...) {} failure = e.what(); }
+    delete ins;
+    conn->setAutoCommit(true);
+
+    // Rollover is an admin override of capacity; bring the seat counters back in line
+    // (also after a failure: the chunks committed before it took seats)
+    int overCapacity = 0;
+    try {
+        sql::Statement* s = conn->createStatement();
+        s->executeUpdate("UPDATE COURSE C SET SeatsTaken = (SELECT COUNT(*) FROM STUDENT_COURSE SC WHERE SC.CourseID = C.CourseID) WHERE C.CourseID IN (SELECT ToCourseID FROM ROLLOVER_MAP)");
+        sql::ResultSet* r = s->executeQuery("SELECT COUNT(*) FROM COURSE WHERE CourseID IN (SELECT ToCourseID FROM ROLLOVER_MAP) AND SeatsTaken > Capacity");
+        if (r->next()) overCapacity = r->getInt(1);
+        delete r; delete s;
+    }
+    catch (sql::SQLException& e) { if (failure.empty()) failure = "Seat recount failed: " + string(e.what()); }
+    emitBulkJob("Term Rollover", committed);
+
+    double secs = secondsSince(start);
+    cout << "\n";
+    if (!failure.empty()) {
+        drawError("Rollover stopped (run it again to continue): " + failure);
+        cout << "   Enrolled before the error: " << committed << endl;
+        if (overCapacity > 0) { setColor(14); cout << "   Courses now over capacity: " << overCapacity << endl; setColor(7); }
+        cout << "\nPress any key..."; (void)_getch();
+        return;
+    }
+    drawSuccess("Term rollover finished.");
+    cout << "   New enrollments:   " << enrolled << endl;
+    cout << "   Already enrolled:  " << max(0LL, candidates - enrolled) << " (skipped)" << endl;
+    if (overCapacity > 0) { setColor(14); cout << "   Courses now over capacity: " << overCapacity << endl; setColor(7); }
+    cout << "   Time:              " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:        " << (long long)(secs > 0 ? enrolled / secs : 0) << " enrollments/s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
+
+// ---- Seat reservation ----
+// COURSE.Capacity (NULL = unlimited) and COURSE.SeatsTaken form an atomic counter.
+// A seat is taken with one conditional UPDATE, so the course row lock is held only for
+// the increment and a full course simply matches no row: no count-then-insert race and
+// no oversubscription however many registrations arrive at once. Students who don't
+// get a seat go on WAITLIST in arrival order.
+struct SeatTables {
+    string course;   // has CourseID, Capacity, SeatsTaken
+    string enroll;   // (StudentID, CourseID)
+    string waitlist; // (WaitID, CourseID, StudentID)
+};
+const SeatTables LIVE_SEATS = { "COURSE", "STUDENT_COURSE", "WAITLIST" };
+const SeatTables STRESS_SEATS = { "SEAT_STRESS", "SEAT_STRESS_ENROLL", "SEAT_STRESS_WAIT" };
+
+// Enrolls the student if a seat is free, otherwise waitlists them. Runs in the caller's
+// transaction. Returns true for a seat.
+bool reserveSeat(sql::Connection* conn, int studentID, int courseID, const SeatTables& t) {
+    sql::PreparedStatement* claim = conn->prepareStatement("UPDATE " + t.course + " SET SeatsTaken = SeatsTaken + 1 WHERE CourseID = ? AND (Capacity IS NULL OR SeatsTaken < Capacity)");
+    claim->setInt(1, courseID);
+    bool seat = claim->executeUpdate() == 1;
+    delete claim;
+
+    sql::PreparedStatement* ins = conn->prepareStatement(seat
+        ? "INSERT INTO " + t.enroll + " (StudentID, CourseID) VALUES (?, ?)"
+        : "INSERT IGNORE INTO " + t.waitlist + " (StudentID, CourseID) VALUES (?, ?)");
+    ins->setInt(1, studentID); ins->setInt(2, courseID);
+    ins->executeUpdate();
+    delete ins;
+    return seat;
+}
+
+// 1-based place in the course's waitlist (0 if not on it)
+int waitlistPosition(sql::Connection* conn, int studentID, int courseID) {
+    sql::PreparedStatement* p = conn->prepareStatement("SELECT COUNT(*) FROM WAITLIST W JOIN WAITLIST ME ON ME.CourseID = W.CourseID AND ME.StudentID = ? WHERE W.CourseID = ? AND W.WaitID <= ME.WaitID");
+    p->setInt(1, studentID); p->setInt(2, courseID);
+    sql::ResultSet* r = p->executeQuery();
+    int pos = r->next() ? r->getInt(1) : 0;
+    delete r; delete p;
+    return pos;
+}
+
+// Moves students from the head of the waitlist into free seats. Runs in the caller's
+// transaction. Returns how many were enrolled.
+int promoteWaitlist(sql::Connection* conn, int courseID) {
+    int promoted = 0;
+    while (true) {
+        sql::PreparedStatement* head = conn->prepareStatement("SELECT WaitID, StudentID FROM WAITLIST WHERE CourseID = ? ORDER BY WaitID LIMIT 1 FOR UPDATE");
+        head->setInt(1, courseID);
+        sql::ResultSet* r = head->executeQuery();
+        int waitID = -1, sid = -1;
+        if (r->next()) { waitID = r->getInt(1); sid = r->getInt(2); }
+        delete r; delete head;
+        if (waitID == -1) break;
+
+        sql::PreparedStatement* claim = conn->prepareStatement("UPDATE COURSE SET SeatsTaken = SeatsTaken + 1 WHERE CourseID = ? AND (Capacity IS NULL OR SeatsTaken < Capacity)");
+        claim->setInt(1, courseID);
+        bool seat = claim->executeUpdate() == 1;
+        delete claim;
+        if (!seat) break;
+
+        sql::PreparedStatement* ins = conn->prepareStatement("INSERT INTO STUDENT_COURSE (StudentID, CourseID) VALUES (?, ?)");
+        ins->setInt(1, sid); ins->setInt(2, courseID); ins->executeUpdate(); delete ins;
+        sql::PreparedStatement* del = conn->prepareStatement("DELETE FROM WAITLIST WHERE WaitID = ?");
+        del->setInt(1, waitID); del->executeUpdate(); delete del;
+        refreshAging(conn, "StudentID = ?", { to_string(sid) }); // the enrollment billed tuition
+        promoted++;
+    }
+    return promoted;
+}
+
+// Registration-opening rush in miniature: many threads, each with its own connection,
+// fight over one course through reserveSeat() on scratch copies of the seat tables,
+// then the counts are checked. Real courses and students are not touched.
+void seatStressTest(sql::Connection* conn) {
+    system("cls"); drawHeader("SEAT RESERVATION STRESS TEST", 13);
+    string capStr = inputString("Seats in the test course (default 100): ");
+    string reqStr = inputString("Registration attempts (default 2000): ");
+    string thrStr = inputString("Threads (default 32): ");
+    int capacity = 100, requests = 2000, threads = 32;
+    try {
+        if (!capStr.empty()) capacity = stoi(capStr);
+        if (!reqStr.empty()) requests = stoi(reqStr);
+        if (!thrStr.empty()) threads = stoi(thrStr);
+    }
+    catch (...) { drawError("Invalid number."); (void)_getch(); return; }
+    if (capacity < 0 || requests <= 0 || threads <= 0 || threads > 256) { drawError("Invalid number."); (void)_getch(); return; }
 
-        while (r4->next()) {
-            if (count >= MAX_ITEMS) break; // prevent crash
-            courseNames[count] = r4->getString("CourseName");
-            revenues[count] = r4->getDouble("Metric");
-            if (revenues[count] > maxRev) maxRev = revenues[count];
-            count++;
+    string host, schema;
+    targetOf(conn, host, schema);
+    try {
+        sql::Statement* s = conn->createStatement();
+        s->execute("DROP TABLE IF EXISTS SEAT_STRESS, SEAT_STRESS_ENROLL, SEAT_STRESS_WAIT");
+        s->execute("CREATE TABLE SEAT_STRESS (CourseID INT PRIMARY KEY, Capacity INT NULL, SeatsTaken INT NOT NULL DEFAULT 0)");
+        s->execute("CREATE TABLE SEAT_STRESS_ENROLL (StudentID INT NOT NULL, CourseID INT NOT NULL, PRIMARY KEY (StudentID, CourseID))");
+        s->execute("CREATE TABLE SEAT_STRESS_WAIT (WaitID INT AUTO_INCREMENT PRIMARY KEY, CourseID INT NOT NULL, StudentID INT NOT NULL, UNIQUE KEY (CourseID, StudentID))");
+        s->execute("INSERT INTO SEAT_STRESS (CourseID, Capacity) VALUES (1, " + to_string(capacity) + ")");
+        delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
+
+    atomic<int> nextStudent(1), granted(0), waitlisted(0), failures(0);
+    string firstError;
+    mutex errorLock;
+    auto worker = [&]() {
+        sql::mysql::get_driver_instance()->threadInit();
+        sql::Connection* wc = nullptr;
+        try { wc = openConnection(host, schema); }
+        catch (sql::SQLException& e) { lock_guard<mutex> lock(errorLock); if (firstError.empty()) firstError = e.what(); }
+        while (wc) {
+            int sid = nextStudent++;
+            if (sid > requests) break;
+            try {
+                wc->setAutoCommit(false);
+                if (reserveSeat(wc, sid, 1, STRESS_SEATS)) granted++; else waitlisted++;
+                wc->commit();
+            }
+            catch (sql::SQLException& e) {
+                failures++;
+                try { wc->rollback(); } catch (...) {}
+                lock_guard<mutex> lock(errorLock);
+                if (firstError.empty()) firstError = e.what();
+            }
+            wc->setAutoCommit(true);
         }
-        delete r4;
+        delete wc;
+        sql::mysql::get_driver_instance()->threadEnd();
+    };
 
-        if (count == 0) cout << "   No revenue data available.\n";
-        else {
-            for (int i = 0; i < count; i++) {
-                
-                int barLen = 0;
-                if (maxRev > 0) {
-                    barLen = (int)((revenues[i] / maxRev) * 30.0);
-                }
+    cout << "\n   Running " << requests << " registrations on " << threads << " threads...\n";
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) pool.emplace_back(worker);
+    for (thread& t : pool) t.join();
+    double secs = secondsSince(start);
 
-                cout << "   " << left << setw(20) << courseNames[i] << " |";
-                if (revenues[i] > 0) setColor(11); else setColor(8);
+    // What actually landed in the tables
+    int seatsTaken = -1, enrolledRows = -1, waitRows = -1;
+    try {
+        sql::Statement* s = conn->createStatement();
+        sql::ResultSet* r = s->executeQuery("SELECT (SELECT SeatsTaken FROM SEAT_STRESS WHERE CourseID = 1), (SELECT COUNT(*) FROM SEAT_STRESS_ENROLL), (SELECT COUNT(*) FROM SEAT_STRESS_WAIT)");
+        if (r->next()) { seatsTaken = r->getInt(1); enrolledRows = r->getInt(2); waitRows = r->getInt(3); }
+        delete r;
+        s->execute("DROP TABLE IF EXISTS SEAT_STRESS, SEAT_STRESS_ENROLL, SEAT_STRESS_WAIT");
+        delete s;
+    }
+    catch (sql::SQLException& e) { drawError(e.what()); }
 
-                // Draw the blocks
-                for (int j = 0; j < barLen; j++) cout << "\xFE";
+    int expectedSeats = min(capacity, requests - failures.load());
+    bool correct = seatsTaken == expectedSeats && enrolledRows == expectedSeats && granted == expectedSeats && waitRows == waitlisted;
+    cout << "\n";
+    if (correct) drawSuccess("Seat counts are correct.");
+    else drawError("Seat counts do not match!");
+    cout << "   Capacity:          " << capacity << endl;
+    cout << "   Seats granted:     " << granted << "   (SeatsTaken " << seatsTaken << ", enrollment rows " << enrolledRows << ")" << endl;
+    cout << "   Waitlisted:        " << waitlisted << "   (waitlist rows " << waitRows << ")" << endl;
+    cout << "   Oversubscribed:    " << max(0, enrolledRows - capacity) << endl;
+    if (failures > 0) cout << "   Failed attempts:   " << failures << "  (" << firstError << ")" << endl;
+    cout << "   Time:              " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:        " << (long long)(secs > 0 ? requests / secs : 0) << " registrations/s" << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
 
-                setColor(7);
-                cout << " $" << (int)revenues[i] << endl;
+// ---- Payment reminders ----
+// A small text template language: {{Field}} is replaced by a value, and the text
+// between {{#Fees}} and {{/Fees}} is repeated once per fee line, where the line's own
+// fields can be used too. Field names are resolved once by parse(), so render() is
+// just appends and can run on many threads at once.
+class TextTemplate {
+public:
+    // fieldNames are the per-letter values, lineFields the per-line ones.
+    // Returns "" or what is wrong with the text.
+    string parse(const string& text, const vector<string>& fieldNames, const vector<string>& lineFields) {
+        parts.clear();
+        int sectionStart = -1;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t open = text.find("{{", pos);
+            if (open == string::npos) { parts.push_back({ LITERAL, text.substr(pos), 0 }); break; }
+            if (open > pos) parts.push_back({ LITERAL, text.substr(pos, open - pos), 0 });
+            size_t close = text.find("}}", open);
+            if (close == string::npos) return "Unclosed {{ at character " + to_string(open + 1);
+            string name = text.substr(open + 2, close - open - 2);
+            pos = close + 2;
+
+            if (name == "#" + LINES_NAME) {
+                if (sectionStart != -1) return "{{#" + LINES_NAME + "}} cannot be nested";
+                sectionStart = (int)parts.size();
+                parts.push_back({ LINES_BEGIN, "", 0 });
+            }
+            else if (name == "/" + LINES_NAME) {
+                if (sectionStart == -1) return "{{/" + LINES_NAME + "}} without {{#" + LINES_NAME + "}}";
+                parts[sectionStart].index = (int)parts.size(); // where the loop ends
+                parts.push_back({ LINES_END, "", 0 });
+                sectionStart = -1;
+            }
+            else {
+                int idx = indexOf(lineFields, name);
+                if (idx != -1 && sectionStart != -1) { parts.push_back({ LINE_FIELD, "", idx }); continue; }
+                idx = indexOf(fieldNames, name);
+                if (idx == -1) return "Unknown field {{" + name + "}}";
+                parts.push_back({ FIELD, "", idx });
             }
         }
+        if (sectionStart != -1) return "{{#" + LINES_NAME + "}} is never closed";
+        return "";
+    }
 
-        cout << "\n\n   [3] ENROLLMENT BY COURSE\n";
-        cout << "   " << string(60, '-') << endl;
+    // Appends the rendered text to out
+    void render(const vector<string>& fields, const vector<vector<string>>& lines, string& out) const {
+        renderRange(0, parts.size(), fields, nullptr, lines, out);
+    }
 
-        string popQuery = "SELECT C.CourseName, COUNT(SC.StudentID) as Metric FROM COURSE C LEFT JOIN STUDENT_COURSE SC ON C.CourseID = SC.CourseID GROUP BY C.CourseID, C.CourseName ORDER BY Metric DESC";
+    static const string LINES_NAME;
 
-        sql::ResultSet* r5 = stmt->executeQuery(popQuery);
+private:
+    enum PartKind { LITERAL, FIELD, LINE_FIELD, LINES_BEGIN, LINES_END };
+    struct Part { PartKind kind; string text; int index; };
 
-        // REUSE ARRAYS (Reuse memory logic)
-        // string courseNames[MAX_ITEMS] - reused
-        int enrolls[MAX_ITEMS];
-        count = 0;
-        int maxPop = 0;
+    static int indexOf(const vector<string>& names, const string& name) {
+        for (size_t i = 0; i < names.size(); i++) if (names[i] == name) return (int)i;
+        return -1;
+    }
 
-        while (r5->next()) {
-            if (count >= MAX_ITEMS) break;
-            courseNames[count] = r5->getString("CourseName");
-            enrolls[count] = r5->getInt("Metric");
-            if (enrolls[count] > maxPop) maxPop = enrolls[count];
-            count++;
+    void renderRange(size_t from, size_t to, const vector<string>& fields, const vector<string>* line, const vector<vector<string>>& lines, string& out) const {
+        for (size_t i = from; i < to; i++) {
+            const Part& p = parts[i];
+            if (p.kind == LITERAL) out += p.text;
+            else if (p.kind == FIELD) out += fields[p.index];
+            else if (p.kind == LINE_FIELD && line) out += (*line)[p.index];
+            else if (p.kind == LINES_BEGIN) {
+                for (const vector<string>& l : lines) renderRange(i + 1, p.index, fields, &l, lines, out);
+                i = p.index; // skip past {{/Fees}}
+            }
         }
-        delete r5;
+    }
 
-        if (count == 0) cout << "   No enrollment data available.\n";
-        else {
-            for (int i = 0; i < count; i++) {
-                int barLen = 0;
-                if (maxPop > 0) {
-                    barLen = (int)(((double)enrolls[i] / maxPop) * 30.0);
+    vector<Part> parts;
+};
+
+const string TextTemplate::LINES_NAME = "Fees";
+
+const vector<string> REMINDER_FIELDS = { "StudentID", "StudentName", "Email", "TotalDue", "FeeCount", "Date" };
+const vector<string> REMINDER_LINE_FIELDS = { "FeeName", "AmountDue", "AmountPaid", "Outstanding", "BilledOn", "DaysOpen" };
+
+// Used when no template file is given
+const string DEFAULT_REMINDER_TEMPLATE =
+    "PAYMENT REMINDER                                        {{Date}}\n"
+    "\n"
+    "Dear {{StudentName}} (Student ID {{StudentID}}),\n"
+    "\n"
+    "Our records show {{FeeCount}} fee(s) still outstanding on your account:\n"
+    "\n"
+    "{{#Fees}}  - {{FeeName}}: ${{Outstanding}} of ${{AmountDue}} (billed {{BilledOn}}, {{DaysOpen}} days ago)\n{{/Fees}}"
+    "\n"
+    "Total outstanding: ${{TotalDue}}\n"
+    "\n"
+    "Please pay through the student portal (Pay Fees) or at the finance office.\n"
+    "If you have paid in the last few days, please ignore this letter.\n"
+    "\n"
+    "Finance Office\n";
+
+// One student's letter data, grouped from consecutive rows of the debtor query
+struct Debtor {
+    int studentID;
+    string campus; // file name prefix when sharded, since StudentIDs repeat across campuses
+    vector<string> fields;
+    vector<vector<string>> lines;
+};
+
+// Writes one reminder file per student with unpaid fees, on every campus. This thread
+// streams one query (ordered by student) per campus and groups the rows into Debtors;
+// batches of them go through a BoundedQueue to worker threads that render the template
+// and write the files. Memory stays at a few batches however many students owe money.
+void generateReminders(sql::Connection* conn) {
+    system("cls"); drawHeader("GENERATE PAYMENT REMINDERS", 13);
+    string templatePath = inputString("Template File (blank = built-in letter): ");
+    string dir = inputString("Output Folder (default reminders): ");
+    string threadStr = inputString("Worker Threads (default 4): ");
+    if (dir.empty()) dir = "reminders";
+    int workerCount = 4;
+    try { if (!threadStr.empty()) workerCount = stoi(threadStr); }
+    catch (...) {}
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > 16) workerCount = 16;
+
+    string templateText = DEFAULT_REMINDER_TEMPLATE;
+    if (!templatePath.empty()) {
+        ifstream in(templatePath, ios::binary);
+        if (!in) { drawError("Cannot open " + templatePath); (void)_getch(); return; }
+        templateText.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    TextTemplate letter;
+    string parseError = letter.parse(templateText, REMINDER_FIELDS, REMINDER_LINE_FIELDS);
+    if (!parseError.empty()) { drawError("Template: " + parseError); (void)_getch(); return; }
+    CreateDirectoryA(dir.c_str(), NULL); // fails harmlessly if it is already there
+
+    time_t t = time(0); char today[16]; strftime(today, sizeof(today), "%Y-%m-%d", localtime(&t));
+
+    const int BATCH = 256;        // debtors per queue item
+    const size_t QUEUE_SIZE = 16; // batches waiting for a worker
+    BoundedQueue<vector<Debtor>*> queue(QUEUE_SIZE);
+    atomic<long long> written(0), bytes(0), writeFailures(0);
+    mutex errorMutex;
+    string firstWriteError;
+
+    auto worker = [&]() {
+        string text;
+        while (true) {
+            vector<Debtor>* batch = nullptr;
+            if (!queue.pop(batch, 100)) { if (queue.isClosed()) break; continue; }
+            for (const Debtor& d : *batch) {
+                text.clear();
+                letter.render(d.fields, d.lines, text);
+                string path = dir + "\\reminder_" + (d.campus.empty() ? "" : d.campus + "_") + to_string(d.studentID) + ".txt";
+                FILE* out = fopen(path.c_str(), "wb");
+                if (!out || fwrite(text.data(), 1, text.size(), out) != text.size()) {
+                    writeFailures++;
+                    lock_guard<mutex> lock(errorMutex);
+                    if (firstWriteError.empty()) firstWriteError = "Cannot write " + path;
                 }
-                cout << "   " << left << setw(20) << courseNames[i] << " |";
-                if (enrolls[i] > 0) setColor(14); else setColor(8);
-                for (int j = 0; j < barLen; j++) cout << "\xFE";
-                setColor(7);
-                cout << " " << enrolls[i] << " Students" << endl;
+                else { written++; bytes += (long long)text.size(); }
+                if (out) fclose(out);
             }
+            delete batch;
         }
-        delete stmt;
-    }
-    catch (sql::SQLException& e) { drawError(e.what()); }
-    cout << "\n\nPress any key..."; (void)_getch();
-}
+    };
 
-void showReliabilityScore(sql::Connection* conn) {
-    system("cls"); drawHeader("STUDENT RELIABILITY SCORE (SRS)", 13);
-    string query = "SELECT * FROM ( SELECT S.StudentName, (SUM(CASE WHEN A.Status='Present' THEN 1.0 ELSE 0.0 END) / COUNT(A.AttendanceID)) * 100.0 AS AttRate, (SUM(SF.AmountPaid) / SUM(SF.AmountDue)) * 100.0 AS PayRate FROM STUDENT S JOIN ATTENDANCE A ON S.StudentID = A.StudentID JOIN STUDENT_FEE SF ON S.StudentID = SF.StudentID GROUP BY S.StudentID) AS T ORDER BY (AttRate + PayRate) DESC";
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int i = 0; i < workerCount; i++) workers.emplace_back(worker);
 
+    long long debtors = 0, feeLines = 0;
+    bool cancelled = false;
+    string failure, missed;
+    double queryMs = 0;
     try {
-        sql::Statement* stmt = conn->createStatement();
-        sql::ResultSet* res = stmt->executeQuery(query);
-
-        cout << "\n   " << left << setw(25) << "Student Name" << setw(12) << "Attend %" << setw(12) << "Fees %" << setw(10) << "Score" << "Grade" << endl;
-        cout << "   " << string(70, '-') << endl;
-
-        bool found = false;
-        int count = 0;
-        double totalScoreSum = 0.0;
-
-        while (res->next()) {
-            found = true; count++;
-            string name = res->getString("StudentName");
-            if (name.length() > 22) name = name.substr(0, 19) + "...";
-
-            double att = res->getDouble("AttRate");
-            double pay = res->getDouble("PayRate");
-            double score = (att + pay) / 2.0;
-            totalScoreSum += score;
-
-            string rating; int color;
-            if (score >= 95) { rating = "S (Elite)"; color = 11; }
-            else if (score >= 85) { rating = "A (Good)";  color = 10; }
-            else if (score >= 70) { rating = "B (Avg)";   color = 14; }
-            else if (score >= 50) { rating = "C (Risk)";  color = 12; }
-            else { rating = "F (Fail)";  color = 4; }
+        vector<Debtor>* batch = new vector<Debtor>();
+        batch->reserve(BATCH);
+        Money total;
+        cout << "\n";
+        // Closes the current student's letter and hands full batches to the workers
+        auto finishDebtor = [&]() {
+            Debtor& d = batch->back();
+            d.fields[3] = total.toString();
+            d.fields[4] = to_string(d.lines.size());
+            debtors++;
+            if ((int)batch->size() < BATCH) return;
+            if (!queue.push(batch)) delete batch;
+            batch = new vector<Debtor>();
+            batch->reserve(BATCH);
+            if (_kbhit() && _getch() == 27) cancelled = true;
+            double secs = secondsSince(start);
+            cout << "\r   Reminders: " << debtors << "   Rate: " << (long long)(secs > 0 ? debtors / secs : 0) << "/s   [ESC] Stop     " << flush;
+        };
 
-            cout << "   " << left << setw(25) << name << fixed << setprecision(0) << att << "%" << setw(5) << " " << fixed << setprecision(0) << pay << "%" << setw(5) << " " << fixed << setprecision(1) << score;
-            cout << "       "; setColor(color); cout << rating << endl; setColor(7);
-        }
-        delete res; delete stmt;
+        // One pass over the main database, or one per campus
+        int passes = dbConfig.shardCount > 0 ? dbConfig.shardCount : 1;
+        for (int pass = 0; pass < passes && !cancelled; pass++) {
+            sql::Connection* c = conn;
+            string campus;
+            if (dbConfig.shardCount > 0) {
+                c = shardConnection(pass);
+                if (!c) { missed += (missed.empty() ? "" : ", ") + dbConfig.shardNames[pass]; continue; }
+                for (char ch : dbConfig.shardNames[pass]) campus += isalnum((unsigned char)ch) ? ch : '_';
+            }
 
-        if (!found) {
-            drawError("No data found (Need Attendance + Fees).");
-        }
-        else {
-            double globalAvg = (count > 0) ? (totalScoreSum / count) : 0.0;
-            cout << "   " << string(70, '-') << endl;
-            cout << "   University Average Score: ";
-            if (globalAvg >= 80) setColor(10); else if (globalAvg >= 60) setColor(14); else setColor(12);
-            cout << fixed << setprecision(1) << globalAvg << "/100" << endl; setColor(7);
-            cout << "\n   Total Students Ranked: " << count << endl;
+            // Oldest bill first inside each letter
+            auto passStart = chrono::steady_clock::now();
+            sql::PreparedStatement* p = c->prepareStatement(
+                "SELECT S.StudentID, S.StudentName, S.Email, F.FeeName, SF.AmountDue, SF.AmountPaid, DATE(SF.BilledAt), DATEDIFF(CURDATE(), SF.BilledAt) "
+                "FROM STUDENT_FEE SF JOIN STUDENT S ON S.StudentID = SF.StudentID JOIN FEE F ON F.FeeID = SF.FeeID "
+                "WHERE SF.Status <> 'Paid' AND SF.AmountDue > SF.AmountPaid ORDER BY SF.StudentID, SF.BilledAt");
+            p->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
+            sql::ResultSet* r = p->executeQuery();
+            queryMs += secondsSince(passStart) * 1000.0;
+
+            int current = -1;
+            while (!cancelled && r->next()) {
+                int sid = r->getInt(1);
+                if (sid != current) {
+                    if (current != -1) finishDebtor();
+                    if (cancelled) break;
+                    current = sid;
+                    total = Money();
+                    batch->push_back({ sid, campus, { to_string(sid), r->getString(2), r->getString(3), "", "", today }, {} });
+                }
+                Money due = Money::fromColumn(r->getString(5));
+                Money paid = Money::fromColumn(r->getString(6));
+                total += due - paid;
+                batch->back().lines.push_back({ r->getString(4), due.toString(), paid.toString(), (due - paid).toString(), r->getString(7), r->getString(8) });
+                feeLines++;
+            }
+            if (current != -1 && !cancelled) finishDebtor();
+            delete r; delete p;
         }
+        if (!batch->empty() && !cancelled) { if (!queue.push(batch)) delete batch; }
+        else delete batch;
     }
-    catch (sql::SQLException& e) { drawError(e.what()); }
-    cout << "\n\nPress any key..."; (void)_getch();
+    catch (sql::SQLException& e) { failure = e.what(); }
+    queue.close();
+    for (auto& w : workers) w.join();
+
+    double secs = secondsSince(start);
+    double mb = bytes / (1024.0 * 1024.0);
+    cout << "\r   " << string(60, ' ') << "\r";
+    if (!failure.empty()) drawError("Stopped: " + failure);
+    else if (cancelled) drawError("Stopped by user. Files already written are complete.");
+    else drawSuccess("Reminders written to " + dir);
+    if (!missed.empty()) drawError("Skipped unavailable campuses: " + missed);
+    if (writeFailures > 0) cout << "   Write failures:    " << writeFailures << "  (" << firstWriteError << ")" << endl;
+    cout << "   Debtors:           " << debtors << "  (" << feeLines << " fee lines)" << endl;
+    cout << "   Files written:     " << written << "  (" << fixed << setprecision(2) << mb << " MB)" << endl;
+    cout << "   Query time:        " << fixed << setprecision(0) << queryMs << " ms until the first row" << (dbConfig.shardCount > 0 ? " (all campuses)" : "") << endl;
+    cout << "   Time:              " << fixed << setprecision(2) << secs << " s" << endl;
+    cout << "   Throughput:        " << (long long)(secs > 0 ? written / secs : 0) << " reminders/s, " << fixed << setprecision(2) << (secs > 0 ? mb / secs : 0.0) << " MB/s on " << workerCount << " threads" << endl;
+    cout << "   Queue peak:        " << queue.peakSize() << " / " << QUEUE_SIZE << " batches  (reader waited " << queue.fullWaitCount() << " times)" << endl;
+    cout << "\nPress any key..."; (void)_getch();
 }
 
-void showDebtList(sql::Connection* conn) {
-    system("cls"); drawHeader("STUDENTS WITH UNPAID FEES", 12);
-    string query = "SELECT S.StudentID, S.StudentName, (SELECT SUM(AmountDue - AmountPaid) FROM STUDENT_FEE WHERE StudentID = S.StudentID AND Status <> 'Paid') AS TotalDebt FROM STUDENT S WHERE S.StudentID IN (SELECT DISTINCT StudentID FROM STUDENT_FEE WHERE Status <> 'Paid') ORDER BY TotalDebt DESC";
-
-    try {
-        sql::Statement* stmt = conn->createStatement();
-        sql::ResultSet* res = stmt->executeQuery(query);
+// ---- Change log ----
+void printChange(const ChangeEvent& ev) {
+    time_t t = (time_t)(ev.timeMs / 1000); char when[32]; strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    string name = ev.type < EV_TYPE_COUNT ? CHANGE_TYPE_NAMES[ev.type] : "?";
+    cout << "   " << left << setw(12) << ev.offset << setw(21) << when << setw(16) << name << right
+        << setw(8) << ev.key1 << setw(8) << ev.key2 << setw(12) << (ev.cents != 0 ? Money{ ev.cents }.toString() : "") << "  " << ev.text << endl;
+}
 
-        cout << "   [FILTER] Showing total outstanding debt per student.\n\n";
-        cout << "   " << left << setw(5) << "ID" << setw(30) << "Student Name" << right << setw(15) << "Total Debt ($)" << endl;
-        cout << "   " << string(60, '-') << endl;
+// Reads the change log from an offset and keeps following it, like a downstream
+// consumer would. The offset to resume from is shown when leaving.
+void showChangeLog() {
+    system("cls"); drawHeader("CHANGE LOG", 11);
+    changeLog.printStats();
+    string from = inputString("\nStart offset (blank = beginning, E = end): ");
+    uint64_t offset = 0;
+    if (from == "E" || from == "e") {
+        vector<uint64_t> starts = listSegments(CHANGE_LOG_DIR);
+        ChangeReader scan(CHANGE_LOG_DIR, starts.empty() ? 0 : starts.back());
+        ChangeEvent ev;
+        while (scan.next(ev)) {}
+        offset = scan.position();
+    }
+    else if (!from.empty()) {
+        try { offset = stoull(from); }
+        catch (...) { drawError("Invalid offset."); (void)_getch(); return; }
+    }
 
-        bool found = false;
-        double grandTotal = 0.0;
-        while (res->next()) {
-            found = true;
-            double debt = res->getDouble("TotalDebt");
-            grandTotal += debt;
-            cout << "   " << left << setw(5) << res->getInt("StudentID") << setw(30) << res->getString("StudentName") << right << setw(15) << fixed << setprecision(2) << debt << endl;
-        }
+    ChangeReader reader(CHANGE_LOG_DIR, offset);
+    cout << "\n   " << left << setw(12) << "Offset" << setw(21) << "Time" << setw(16) << "Event" << right
+        << setw(8) << "Key1" << setw(8) << "Key2" << setw(12) << "Amount" << "  Text" << endl;
+    cout << "   " << string(90, '-') << endl;
+    setColor(8); cout << "   Following new events, ESC to stop." << endl; setColor(7);
+    long long shown = 0;
+    while (true) {
+        ChangeEvent ev;
+        while (reader.next(ev)) { printChange(ev); shown++; }
+        if (_kbhit() && _getch() == 27) break;
+        Sleep(200);
+    }
+    cout << "\n   Events shown: " << shown << "   Resume from offset " << reader.position() << endl;
+    cout << "\nPress any key..."; (void)_getch();
+}
 
-        if (!found) drawSuccess("Amazing! No students owe any fees.");
-        else {
-            cout << "   " << string(60, '-') << endl;
-            setColor(12);
-            cout << "   " << left << setw(35) << "TOTAL OUTSTANDING:" << right << setw(15) << fixed << setprecision(2) << grandTotal << endl;
-            setColor(7);
+void dataToolsMenu(sql::Connection* conn) {
+    system("cls");
+    while (true) {
+        string dops[] = { "Export Transaction Ledger", "Rebuild Course Revenue", "Billing Run", "Ingest Card Taps", "Reconcile Ledger", "Archive Graduates", "Balance As Of Date", "Term Rollover", "Seat Stress Test", "Tier Closed Terms", "Payment Reminders", "Change Log", "Back" };
+        int dCount = 13;
+        int dch = 0;
+        while (true) {
+            drawMenuFrame("DATA TOOLS", dops, dCount, dch);
+            char k = (char)_getch();
+            if (k == 72) dch = (dch - 1 + dCount) % dCount;
+            if (k == 80) dch = (dch + 1) % dCount;
+            if (k == 13) break;
         }
-        delete res; delete stmt;
+        if (dch == dCount - 1) break;
+        if (dch == 0) exportLedger(readConnection(conn));
+        if (dch == 1) rebuildCourseRevenue(conn, true);
+        if (dch == 2) runBilling(conn);
+        if (dch == 3) ingestTapLog(conn);
+        if (dch == 4) reconcileLedger(conn);
+        if (dch == 5) archiveStudents(conn);
+        if (dch == 6) showBalanceAsOf(readConnection(conn));
+        if (dch == 7) termRollover(conn);
+        if (dch == 8) seatStressTest(conn);
+        if (dch == 9) tierClosedTerms(conn);
+        if (dch == 10) generateReminders(readConnection(conn));
+        if (dch == 11) showChangeLog();
+        resultCache.bumpAll(); // the jobs above rewrite whole tables
+        system("cls");
     }
-    catch (sql::SQLException& e) { drawError(e.what()); }
-    cout << "\nPress any key..."; (void)_getch();
 }
 
 void addCourse(sql::Connection* conn) {
@@ -630,13 +4141,28 @@ void addCourse(sql::Connection* conn) {
     string name = inputString("Course Name (e.g. Cyber Security B): ");
     string credits = inputString("Credit Hours: ");
     string feeStr = inputString("Semester Fee ($): ");
+    string capStr = inputString("Seat Capacity (blank = unlimited): ");
+    Money fee;
+    if (!Money::parse(feeStr, fee) || fee.cents < 0) { drawError("Invalid fee amount."); (void)_getch(); return; }
+    int capacity = 0;
+    try { if (!capStr.empty()) capacity = stoi(capStr); }
+    catch (...) { drawError("Invalid capacity."); (void)_getch(); return; }
     try {
         conn->setAutoCommit(false);
-        sql::PreparedStatement* p = conn->prepareStatement("INSERT INTO COURSE (CourseName, CreditHours, SemesterFee) VALUES (?, ?, ?)");
-        p->setString(1, name); p->setInt(2, stoi(credits)); p->setDouble(3, stod(feeStr)); p->executeUpdate(); delete p;
-        sql::PreparedStatement* f = conn->prepareStatement("INSERT INTO FEE (FeeName, Amount, IsTuition) VALUES (?, ?, 1)");
-        f->setString(1, "Tuition: " + name); f->setDouble(2, stod(feeStr)); f->executeUpdate(); delete f;
-        conn->commit(); drawSuccess("Course & Tuition Fee Created Successfully!");
+        sql::PreparedStatement* p = conn->prepareStatement("INSERT INTO COURSE (CourseName, CreditHours, SemesterFee, Capacity) VALUES (?, ?, ?, ?)");
+        p->setString(1, name); p->setInt(2, stoi(credits)); p->setString(3, fee.toString());
+        if (capacity > 0) p->setInt(4, capacity); else p->setNull(4, sql::DataType::INTEGER);
+        p->executeUpdate(); delete p;
+        int newCid = -1;
+        sql::Statement* idq = conn->createStatement();
+        sql::ResultSet* idr = idq->executeQuery("SELECT LAST_INSERT_ID()");
+        if (idr->next()) newCid = idr->getInt(1);
+        delete idr; delete idq;
+        sql::PreparedStatement* f = conn->prepareStatement("INSERT INTO FEE (FeeName, Amount, IsTuition, CourseID) VALUES (?, ?, 1, ?)");
+        f->setString(1, "Tuition: " + name); f->setString(2, fee.toString()); f->setInt(3, newCid); f->executeUpdate(); delete f;
+        conn->commit(); bumpTables({ "COURSE", "FEE" });
+        emitChange(EV_COURSE_ADDED, newCid, 0, fee.cents, name);
+        drawSuccess("Course & Tuition Fee Created Successfully!");
     }
     catch (sql::SQLException& e) { conn->rollback(); drawError("Failed: " + string(e.what())); }
     conn->setAutoCommit(true); (void)_getch();
@@ -644,7 +4170,7 @@ void addCourse(sql::Connection* conn) {
 
 void editCourse(sql::Connection* conn) {
     system("cls"); drawHeader("EDIT COURSE", 13);
-    int cid = 0; string oldName; double oldFee;
+    int cid = 0; string oldName; Money oldFee;
     if (!selectCourse(conn, cid, oldName, oldFee)) return;
 
     cout << "\n--- Editing " << oldName << " ---\n";
@@ -653,30 +4179,58 @@ void editCourse(sql::Connection* conn) {
     string newName = inputString("New Name: ");
     string newCred = inputString("New Credit Hours: ");
     string newFeeStr = inputString("New Fee Amount: ");
-
+    string newCapStr = inputString("New Seat Capacity (0 = unlimited): ");
+
+    Money newFee = oldFee;
+    int credits = -1, capacity = -1;
+    if (!newFeeStr.empty() && (!Money::parse(newFeeStr, newFee) || newFee.cents < 0)) { drawError("Invalid fee amount."); (void)_getch(); return; }
+    try { if (!newCred.empty()) credits = stoi(newCred); }
+    catch (...) { drawError("Invalid credit hours."); (void)_getch(); return; }
+    try { if (!newCapStr.empty()) capacity = stoi(newCapStr); }
+    catch (...) { drawError("Invalid capacity."); (void)_getch(); return; }
+    if (newName.empty() && credits == -1 && newFeeStr.empty() && capacity == -1) return;
+
+    string name = newName.empty() ? oldName : newName;
+    int courseRows = 0, feeRows = 0, billedRows = 0, promoted = 0;
     try {
         conn->setAutoCommit(false);
-        string updateQ = "UPDATE COURSE SET ";
-        bool comma = false;
-        if (!newName.empty()) { updateQ += "CourseName = '" + newName + "'"; comma = true; }
-        if (!newCred.empty()) { if (comma) updateQ += ", "; updateQ += "CreditHours = " + newCred; comma = true; }
-        if (!newFeeStr.empty()) { if (comma) updateQ += ", "; updateQ += "SemesterFee = " + newFeeStr; }
-        updateQ += " WHERE CourseID = " + to_string(cid);
-
-        if (comma || !newFeeStr.empty()) {
-            sql::Statement* s = conn->createStatement(); s->executeUpdate(updateQ); delete s;
+        // COALESCE keeps the old value for anything left blank
+        sql::PreparedStatement* c = conn->prepareStatement("UPDATE COURSE SET CourseName = ?, CreditHours = COALESCE(?, CreditHours), SemesterFee = ? WHERE CourseID = ?");
+        c->setString(1, name);
+        if (credits == -1) c->setNull(2, sql::DataType::INTEGER); else c->setInt(2, credits);
+        c->setString(3, newFee.toString());
+        c->setInt(4, cid);
+        courseRows = c->executeUpdate(); delete c;
+
+        // The tuition fee is found by its CourseID, so earlier renames don't matter
+        sql::PreparedStatement* f = conn->prepareStatement("UPDATE FEE SET FeeName = ?, Amount = ? WHERE CourseID = ? AND IsTuition = 1");
+        f->setString(1, "Tuition: " + name);
+        f->setString(2, newFee.toString());
+        f->setInt(3, cid);
+        feeRows = f->executeUpdate(); delete f;
+
+        // Students already billed and not fully paid get the new amount, in one statement
+        if (!(newFee == oldFee)) {
+            sql::PreparedStatement* b = conn->prepareStatement("UPDATE STUDENT_FEE SF JOIN FEE F ON SF.FeeID = F.FeeID SET SF.AmountDue = ?, SF.Status = CASE WHEN SF.AmountPaid >= ? THEN 'Paid' WHEN SF.AmountPaid > 0 THEN 'Partial' ELSE 'Unpaid' END WHERE F.CourseID = ? AND F.IsTuition = 1 AND SF.Status <> 'Paid'");
+            b->setString(1, newFee.toString());
+            b->setString(2, newFee.toString());
+            b->setInt(3, cid);
+            billedRows = b->executeUpdate(); delete b;
+            refreshAging(conn, "StudentID IN (SELECT SF.StudentID FROM STUDENT_FEE SF JOIN FEE F ON SF.FeeID = F.FeeID WHERE F.CourseID = ? AND F.IsTuition = 1)", { to_string(cid) });
         }
-
-        if (!newName.empty() || !newFeeStr.empty()) {
-            string targetFeeName = "Tuition: " + oldName;
-            string feeUpdateQ = "UPDATE FEE SET ";
-            bool fComma = false;
-            if (!newName.empty()) { feeUpdateQ += "FeeName = 'Tuition: " + newName + "'"; fComma = true; }
-            if (!newFeeStr.empty()) { if (fComma) feeUpdateQ += ", "; feeUpdateQ += "Amount = " + newFeeStr; }
-            feeUpdateQ += " WHERE FeeName = '" + targetFeeName + "'";
-            sql::Statement* s2 = conn->createStatement(); s2->executeUpdate(feeUpdateQ); delete s2;
+        // More seats (or none below the new limit) let waitlisted students in
+        if (capacity >= 0) {
+            sql::PreparedStatement* cap = conn->prepareStatement("UPDATE COURSE SET Capacity = ? WHERE CourseID = ?");
+            if (capacity > 0) cap->setInt(1, capacity); else cap->setNull(1, sql::DataType::INTEGER);
+            cap->setInt(2, cid);
+            cap->executeUpdate(); delete cap;
+            promoted = promoteWaitlist(conn, cid);
         }
-        conn->commit(); drawSuccess("Course & Linked Fees Updated Successfully!");
+        conn->commit(); bumpTables({ "COURSE", "FEE", "STUDENT_FEE", "STUDENT_COURSE", "WAITLIST" });
+        emitChange(EV_COURSE_CHANGED, cid, promoted, newFee.cents, name);
+        drawSuccess("Course & Linked Fees Updated Successfully!");
+        cout << "   Course rows: " << courseRows << "   Tuition fees: " << feeRows << "   Student bills updated: " << billedRows << endl;
+        if (promoted > 0) cout << "   Enrolled from the waitlist: " << promoted << endl;
     }
     catch (sql::SQLException& e) { conn->rollback(); drawError("Update Failed: " + string(e.what())); }
     conn->setAutoCommit(true); (void)_getch();
@@ -684,39 +4238,45 @@ void editCourse(sql::Connection* conn) {
 
 void removeCourse(sql::Connection* conn) {
     system("cls"); drawHeader("DELETE COURSE", 12);
-    int dummyID; string dummyName; double dummyFee;
+    int dummyID; string dummyName; Money dummyFee;
     if (!selectCourse(conn, dummyID, dummyName, dummyFee)) return;
     if (inputString("\nType CONFIRM to delete this course: ") == "CONFIRM") {
         try {
+            sql::PreparedStatement* w = conn->prepareStatement("DELETE FROM WAITLIST WHERE CourseID=?");
+            w->setInt(1, dummyID); w->executeUpdate(); delete w;
             sql::PreparedStatement* p = conn->prepareStatement("DELETE FROM COURSE WHERE CourseID=?");
-            p->setInt(1, dummyID); p->executeUpdate(); delete p; drawSuccess("Course Deleted.");
+            p->setInt(1, dummyID); p->executeUpdate(); delete p;
+            bumpTables({ "COURSE", "FEE", "STUDENT_COURSE", "WAITLIST" });
+            emitChange(EV_COURSE_REMOVED, dummyID, 0, 0, dummyName);
+            drawSuccess("Course Deleted.");
         }
         catch (sql::SQLException& e) { drawError(e.what()); }
     }
     (void)_getch();
 }
 
-bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName, double& outFee) {
+bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName, Money& outFee) {
     system("cls"); drawHeader("SELECT COURSE", 11);
     try {
-        sql::Statement* stmt = conn->createStatement();
+        // Every course screen opens this picker, so the listing comes from the result cache
         string query = "SELECT C.CourseID, C.CourseName, C.SemesterFee, T.TeacherName FROM COURSE C LEFT JOIN TEACHER T ON C.Lecturer_ID = T.TeacherID ORDER BY C.CourseID ASC";
-        sql::ResultSet* res = stmt->executeQuery(query);
+        QueryResult res = cachedQuery(conn, query, {}, { "COURSE", "TEACHER" });
+        if (!res.ok()) { drawError(res.error); return false; }
 
         int cIds[MAX_ITEMS];
         string cNames[MAX_ITEMS];
-        double cFees[MAX_ITEMS];
+        Money cFees[MAX_ITEMS];
         int count = 0;
 
         cout << "\n   " << left << setw(5) << "ID" << setw(30) << "Course Name" << setw(25) << "Current Lecturer" << "Fee($)" << endl;
         cout << "   " << string(75, '-') << endl;
 
-        while (res->next()) {
+        for (size_t row = 0; row < res.size(); row++) {
             if (count >= MAX_ITEMS) break;
-            int id = res->getInt("CourseID");
-            string name = res->getString("CourseName");
-            double fee = res->getDouble("SemesterFee");
-            string teacher = res->getString("TeacherName");
+            int id = res.integer(row, 0);
+            string name = res.text(row, 1);
+            Money fee = res.money(row, 2);
+            string teacher = res.text(row, 3);
             if (teacher.empty()) teacher = "[OPEN]";
 
             cIds[count] = id;
@@ -726,10 +4286,9 @@ bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName
             cout << "   " << left << setw(5) << id << setw(30) << name;
             if (teacher == "[OPEN]") setColor(10); else setColor(7);
             cout << setw(25) << teacher; setColor(7);
-            cout << "$" << fee << endl;
+            cout << "$" << fee.toString() << endl;
             count++;
         }
-        delete res; delete stmt;
 
         if (count == 0) { drawError("No courses found."); return false; }
 
@@ -750,170 +4309,231 @@ bool selectCourse(sql::Connection* conn, int& outCourseID, string& outCourseName
     catch (...) { drawError("Invalid input."); return false; }
 }
 
-void viewAttendance(sql::Connection* conn, int studentID) {
-    system("cls"); drawHeader("MY ATTENDANCE RECORD", 11);
-    try {
-        string q = "SELECT A.AttendanceDate, A.Status, C.CourseName FROM ATTENDANCE A JOIN COURSE C ON A.CourseID = C.CourseID WHERE A.StudentID=? ORDER BY A.AttendanceDate DESC";
-        sql::PreparedStatement* p = conn->prepareStatement(q);
-        p->setInt(1, studentID);
-        sql::ResultSet* r = p->executeQuery();
+// Heatmap cell color for an attendance rate (-1 = no classes)
+int attendanceColor(double rate) {
+    if (rate < 0) return 8;
+    if (rate >= 90) return 10;
+    if (rate >= 75) return 14;
+    return 12;
+}
 
+// Raw roll call rows for one month or week only, picked from the heatmap
+void showAttendancePeriod(sql::Connection* conn, int studentID, const string& periodStart, bool weekly) {
+    system("cls"); drawHeader(weekly ? "ATTENDANCE: WEEK OF " + periodStart : "ATTENDANCE: " + periodStart.substr(0, 7), 11);
+    // Periods before this term may have been moved into ATTENDANCE_HISTORY
+    time_t t = time(0); char buf[16]; strftime(buf, sizeof(buf), "%Y-%m-%d", localtime(&t));
+    string table = periodStart < termStart(buf) ? "ATTENDANCE_ALL" : "ATTENDANCE";
+    string q = "SELECT A.AttendanceDate, A.Status, C.CourseName FROM " + table + " A JOIN COURSE C ON A.CourseID = C.CourseID "
+        + "WHERE A.StudentID = ? AND A.AttendanceDate >= ? AND A.AttendanceDate < DATE_ADD(?, INTERVAL 1 " + (weekly ? "WEEK" : "MONTH") + ") ORDER BY A.AttendanceDate";
+    QueryResult r = queryPoolFor(conn).submit(q, { to_string(studentID), periodStart, periodStart }).get();
+    if (r.ok()) {
         int pCount = 0, aCount = 0;
         cout << left << setw(15) << "Date" << setw(10) << "Status" << "Course" << endl;
         cout << string(60, '-') << endl;
-        while (r->next()) {
-            string s = r->getString("Status");
-            cout << left << setw(15) << r->getString("AttendanceDate") << setw(10) << s << r->getString("CourseName") << endl;
+        for (size_t i = 0; i < r.size(); i++) {
+            string s = r.text(i, 1);
+            cout << left << setw(15) << r.text(i, 0).substr(0, 10) << setw(10) << s << r.text(i, 2) << endl;
             if (s == "Present") pCount++; else aCount++;
         }
         cout << "\nSummary: Present: " << pCount << " | Absent/Late: " << aCount << endl;
-        delete r; delete p;
     }
-    catch (...) { drawError("Error retrieving attendance."); }
+    else drawError("Error retrieving attendance.");
     cout << "\nPress any key..."; (void)_getch();
 }
 
-void takeAttendance(sql::Connection* conn, int teacherID) {
-    int courseID = -1; string courseName = "";
-    try {
-        sql::PreparedStatement* p = conn->prepareStatement("SELECT CourseID, CourseName FROM COURSE WHERE Lecturer_ID = ?");
-        p->setInt(1, teacherID); sql::ResultSet* r = p->executeQuery();
-
-        int cIds[MAX_ITEMS];
-        string cNames[MAX_ITEMS];
-        int count = 0;
-
-        while (r->next()) {
-            if (count >= MAX_ITEMS) break;
-            cIds[count] = r->getInt("CourseID");
-            cNames[count] = r->getString("CourseName");
-            count++;
+// Per-course totals and a period x course heatmap, all aggregated by MySQL, so the
+// screen reads a few dozen rows however long the student's history is.
+// ENTER on a period fetches that period's raw rows. Only the current term is shown
+// until H brings in earlier terms.
+void viewAttendance(sql::Connection* conn, int studentID, StudentCache* cache) {
+    const int MAX_COLS = 6; // courses shown side by side in the heatmap
+    bool weekly = false;
+    bool history = false;
+    int sel = 0;
+    bool reload = true;
+    QueryResult totals, grid;
+    system("cls");
+    while (true) {
+        if (reload) {
+            totals = loadStudentData(conn, studentID, DS_ATTENDANCE, cache, history);
+            grid = loadStudentData(conn, studentID, weekly ? DS_ATTENDANCE_WEEKS : DS_ATTENDANCE_MONTHS, cache, history);
+            if (!totals.ok() || !grid.ok()) { drawError("Error retrieving attendance."); (void)_getch(); return; }
+            reload = false;
         }
-        delete r; delete p;
-
-        if (count == 0) { drawError("No courses assigned to you."); (void)_getch(); return; }
-        courseID = cIds[0]; courseName = cNames[0];
-    }
-    catch (sql::SQLException& e) { drawError(e.what()); return; }
-
-    struct StudentAtt { int id; string name; string status; };
-    StudentAtt students[MAX_ITEMS];
-    int sCount = 0;
 
-    try {
-        sql::PreparedStatement* p = conn->prepareStatement("SELECT S.StudentID, S.StudentName FROM STUDENT S JOIN STUDENT_COURSE SC ON S.StudentID = SC.StudentID WHERE SC.CourseID = ?");
-        p->setInt(1, courseID); sql::ResultSet* r = p->executeQuery();
-
-        sql::PreparedStatement* check = conn->prepareStatement("SELECT Status FROM ATTENDANCE WHERE StudentID=? AND CourseID=? AND DATE(AttendanceDate)=CURDATE()");
+        // Rows are (period, course, present, absent, late), newest period first
+        vector<string> periods;
+        map<pair<string, string>, double> rates;
+        for (size_t i = 0; i < grid.size(); i++) {
+            string period = grid.text(i, 0);
+            if (periods.empty() || periods.back() != period) periods.push_back(period);
+            int p = grid.integer(i, 2), total = p + grid.integer(i, 3) + grid.integer(i, 4);
+            rates[{ period, grid.text(i, 1) }] = total > 0 ? p * 100.0 / total : -1;
+        }
+        if (sel >= (int)periods.size()) sel = max(0, (int)periods.size() - 1);
 
-        while (r->next()) {
-            if (sCount >= MAX_ITEMS) break;
-            int sid = r->getInt("StudentID");
-            string sName = r->getString("StudentName");
-            string currentStatus = "Present";
-            check->setInt(1, sid);
-            check->setInt(2, courseID);
-            sql::ResultSet* rsCheck = check->executeQuery();
-            if (rsCheck->next()) {
-                currentStatus = rsCheck->getString("Status");
+        gotoxy(0, 0);
+        drawHeader(history ? "MY ATTENDANCE RECORD (ALL TERMS)" : "MY ATTENDANCE RECORD (THIS TERM)", 11);
+        cout << "   " << left << setw(30) << "Course" << setw(10) << "Present" << setw(10) << "Absent" << setw(8) << "Late" << "Rate" << endl;
+        cout << "   " << string(64, '-') << endl;
+        int pAll = 0, allTotal = 0;
+        for (size_t i = 0; i < totals.size(); i++) {
+            int p = totals.integer(i, 1), a = totals.integer(i, 2), l = totals.integer(i, 3);
+            double rate = (p + a + l) > 0 ? p * 100.0 / (p + a + l) : -1;
+            pAll += p; allTotal += p + a + l;
+            cout << "   " << left << setw(30) << totals.text(i, 0).substr(0, 28) << setw(10) << p << setw(10) << a << setw(8) << l;
+            setColor(attendanceColor(rate)); cout << fixed << setprecision(0) << max(rate, 0.0) << "%" << endl; setColor(7);
+        }
+        cout << "   Overall: " << pAll << " of " << allTotal << " classes attended" << endl;
+
+        cout << "\n   " << (weekly ? "WEEKLY" : "MONTHLY") << " HEATMAP (last 12 " << (weekly ? "weeks" : "months") << (history ? ")" : " of this term)") << endl;
+        cout << "      " << left << setw(18) << "Period";
+        int cols = min((int)totals.size(), MAX_COLS);
+        for (int c = 0; c < cols; c++) cout << setw(11) << totals.text(c, 0).substr(0, 9);
+        cout << endl;
+        if (periods.empty()) { setColor(8); cout << "      (no classes in this range)" << endl; setColor(7); }
+        for (int r = 0; r < (int)periods.size(); r++) {
+            string label = weekly ? "Wk " + periods[r] : periods[r].substr(0, 7);
+            if (r == sel) { setColor(14); cout << "   >> "; } else cout << "      ";
+            cout << left << setw(18) << label; setColor(7);
+            for (int c = 0; c < cols; c++) {
+                auto it = rates.find({ periods[r], totals.text(c, 0) });
+                double rate = (it == rates.end()) ? -1 : it->second;
+                setColor(attendanceColor(rate));
+                if (rate < 0) cout << setw(11) << "  --";
+                else { cout << "\xDB\xDB " << right << setw(3) << fixed << setprecision(0) << rate << "%" << left << "   "; }
+                setColor(7);
             }
-            delete rsCheck;
-
-            students[sCount].id = sid;
-            students[sCount].name = sName;
-            students[sCount].status = currentStatus;
-            sCount++;
+            cout << endl;
         }
-        delete check; delete r; delete p;
+        if ((int)totals.size() > cols) { setColor(8); cout << "      (" << totals.size() - cols << " more courses in the totals above)" << endl; setColor(7); }
+
+        setColor(8); cout << "\n   [UP/DOWN] Period  [ENTER] Details  [W] " << (weekly ? "Monthly" : "Weekly") << " view  [H] " << (history ? "This term" : "Include history") << "  [ESC] Back" << endl; setColor(7);
+
+        char key = (char)_getch();
+        if (key == 27) break;
+        else if (key == 72) { if (sel > 0) sel--; }
+        else if (key == 80) { if (sel + 1 < (int)periods.size()) sel++; }
+        else if (key == 'w' || key == 'W') { weekly = !weekly; sel = 0; reload = true; system("cls"); }
+        else if (key == 'h' || key == 'H') { history = !history; sel = 0; reload = true; system("cls"); }
+        else if (key == 13 && !periods.empty()) { showAttendancePeriod(conn, studentID, periods[sel], weekly); system("cls"); }
     }
-    catch (...) { return; }
+}
 
-    if (sCount == 0) { drawError("No students enrolled."); (void)_getch(); return; }
 
-    int selectedIdx = 0;
-    time_t t = time(0); struct tm* now = localtime(&t); char buf[80]; strftime(buf, sizeof(buf), "%Y-%m-%d", now); string todayStr = string(buf);
+// Roll call over the teacher's roster: LEFT/RIGHT switches section, edits stay in
+// memory (across visits to this screen) until S saves every section at once
+void takeAttendance(sql::Connection* conn, int teacherID, TeacherRoster* roster) {
+    TeacherRoster local(conn, teacherID);
+    if (!roster) { local.load(); roster = &local; }
+    // Yesterday's roster with nothing left to save is just read again
+    if (roster->day() != todayNumber() && roster->unsaved() == 0) roster->load();
+    if (!roster->error().empty()) { drawError(roster->error()); (void)_getch(); return; }
+    if (roster->sections().empty()) { drawError("No courses assigned to you."); (void)_getch(); return; }
 
+    int sec = 0, selectedIdx = 0;
     system("cls");
     while (true) {
+        vector<RosterSection>& sections = roster->sections();
+        if (sec >= (int)sections.size()) sec = 0;
+        RosterSection& cur = sections[sec];
+        cur.opened = true;
+        int sCount = (int)cur.students.size();
+        if (selectedIdx >= sCount) selectedIdx = max(0, sCount - 1);
+
         gotoxy(0, 0);
-        drawHeader("ROLL CALL: " + courseName, 11);
-        setColor(14); printCentered("Date: " + todayStr); setColor(7); cout << "\n";
+        drawHeader("ROLL CALL: " + cur.courseName, 11);
+        setColor(14); printCentered("Date: " + dateOfDay(roster->day())); setColor(7);
+        cout << "   ";
+        for (int i = 0; i < (int)sections.size(); i++) {
+            int edits = 0;
+            if (sections[i].opened) for (const RosterEntry& e : sections[i].students) if (e.status != e.savedStatus) edits++;
+            setColor(i == sec ? 14 : 8);
+            cout << "[" << sections[i].courseName.substr(0, 14) << (edits > 0 ? "*" : "") << "] ";
+        }
+        setColor(7); cout << "\n\n";
         cout << "   " << left << setw(5) << "No." << setw(30) << "Name" << "Status" << endl;
         cout << "   " << string(50, '-') << endl;
 
+        if (sCount == 0) { setColor(8); cout << "   No students enrolled." << endl; setColor(7); }
         for (int i = 0; i < sCount; ++i) {
+            const RosterEntry& e = cur.students[i];
             cout << "   ";
             if (i == selectedIdx) setColor(14); else setColor(7);
-            cout << left << setw(5) << (i + 1) << setw(30) << students[i].name << setw(10) << students[i].status << endl;
+            cout << left << setw(5) << (i + 1) << setw(30) << e.name << setw(10) << e.status << (e.status != e.savedStatus ? "*" : " ") << endl;
         }
         setColor(7);
-        cout << "\n   [UP/DOWN] Move  [ENTER] Toggle Status  [S] Save  [ESC] Cancel\n";
+        cout << "\n   [UP/DOWN] Move  [LEFT/RIGHT] Section  [ENTER] Toggle Status  [S] Save All  [R] Reload  [ESC] Back\n";
+        int unsaved = roster->unsaved();
+        setColor(8); cout << "   " << left << setw(60) << (unsaved > 0 ? to_string(unsaved) + " unsaved (* = not saved yet)" : string("All changes saved")) << endl; setColor(7);
 
         char k = (char)_getch();
-        if (k == 72) selectedIdx = (selectedIdx - 1 + sCount) % sCount;
-        else if (k == 80) selectedIdx = (selectedIdx + 1) % sCount;
-        else if (k == 13) {
-            if (students[selectedIdx].status == "Present") students[selectedIdx].status = "Absent";
-            else if (students[selectedIdx].status == "Absent") students[selectedIdx].status = "Late";
-            else students[selectedIdx].status = "Present";
+        if (k == 72 && sCount > 0) selectedIdx = (selectedIdx - 1 + sCount) % sCount;
+        else if (k == 80 && sCount > 0) selectedIdx = (selectedIdx + 1) % sCount;
+        else if (k == 75 || k == 77) {
+            int n = (int)sections.size();
+            sec = (k == 75) ? (sec - 1 + n) % n : (sec + 1) % n;
+            selectedIdx = 0;
+            system("cls");
+        }
+        else if (k == 13 && sCount > 0) {
+            string& status = cur.students[selectedIdx].status;
+            if (status == "Present") status = "Absent";
+            else if (status == "Absent") status = "Late";
+            else status = "Present";
         }
         else if (k == 's' || k == 'S') {
-            try {
-                sql::PreparedStatement* upd = conn->prepareStatement("UPDATE ATTENDANCE SET Status=? WHERE StudentID=? AND CourseID=? AND DATE(AttendanceDate)=CURDATE()");
-                sql::PreparedStatement* ins = conn->prepareStatement("INSERT INTO ATTENDANCE (StudentID, CourseID, AttendanceDate, Status) VALUES (?, ?, CURDATE(), ?)");
-
-                for (int i = 0; i < sCount; i++) {
-                    upd->setString(1, students[i].status);
-                    upd->setInt(2, students[i].id);
-                    upd->setInt(3, courseID);
-                    int rows = upd->executeUpdate();
-                    if (rows == 0) {
-                        ins->setInt(1, students[i].id);
-                        ins->setInt(2, courseID);
-                        ins->setString(3, students[i].status);
-                        ins->executeUpdate();
-                    }
-                }
-                delete upd; delete ins;
-                drawSuccess("Attendance Saved (Updated).");
-            }
-            catch (sql::SQLException& e) { drawError(e.what()); }
+            string err = roster->save();
+            if (err.empty()) drawSuccess("Attendance Saved (Updated).");
+            else drawError(err);
             (void)_getch(); return;
         }
+        else if (k == 'r' || k == 'R') {
+            string ask = unsaved > 0 ? inputString("   Discard " + to_string(unsaved) + " unsaved changes? (Y/N): ") : "Y";
+            if (ask == "Y" || ask == "y") roster->load();
+            if (!roster->error().empty()) { drawError(roster->error()); (void)_getch(); return; }
+            if (roster->sections().empty()) { drawError("No courses assigned to you."); (void)_getch(); return; }
+            system("cls");
+        }
         else if (k == 27) return;
     }
 }
 
-void payFees(sql::Connection* conn, string studentUsername) {
+void payFees(sql::Connection* conn, string studentUsername, StudentCache* cache) {
     system("cls"); drawHeader("PAY SCHOOL FEES", 11);
-    int sid = getStudentID(conn, studentUsername);
+    int sid = cache ? cache->studentID() : getStudentID(conn, studentUsername);
     if (sid == -1) return;
 
+    // The receipt needs the student's name; without a session cache fetch it on the pool while the fee list loads
+    future<QueryResult> nameF;
+    if (!cache) nameF = queryPoolFor(conn).submit(STUDENT_QUERIES[DS_PROFILE], { to_string(sid) });
+
     try {
         // Only show fees that are NOT 'Paid' yet
-        sql::PreparedStatement* p = conn->prepareStatement("SELECT SF.SFID, F.FeeName, SF.AmountDue, SF.AmountPaid FROM STUDENT_FEE SF JOIN FEE F ON SF.FeeID=F.FeeID WHERE SF.StudentID=? AND SF.Status<>'Paid'");
-        p->setInt(1, sid); sql::ResultSet* r = p->executeQuery();
+        QueryResult r = loadStudentData(conn, sid, DS_UNPAID_FEES, cache);
+        if (!r.ok()) throw sql::SQLException(r.error);
 
         int ids[MAX_ITEMS];
-        double dues[MAX_ITEMS];
-        double paids[MAX_ITEMS];
+        Money dues[MAX_ITEMS];
+        Money paids[MAX_ITEMS];
+        string feeNames[MAX_ITEMS];
         int count = 0;
 
         int idx = 1;
-        while (r->next()) {
+        for (size_t row = 0; row < r.size(); row++) {
             if (count >= MAX_ITEMS) break;
-            double total = r->getDouble("AmountDue");
-            double paid = r->getDouble("AmountPaid");
+            Money total = r.money(row, 2);
+            Money paid = r.money(row, 3);
 
             // Calculate what is left to pay
-            cout << idx++ << ". " << r->getString("FeeName") << " | Owe: $" << fixed << setprecision(2) << (total - paid) << endl;
+            feeNames[count] = r.text(row, 1);
+            cout << idx++ << ". " << feeNames[count] << " | Owe: $" << (total - paid).toString() << endl;
 
-            ids[count] = r->getInt("SFID");
+            ids[count] = r.integer(row, 0);
             dues[count] = total;
             paids[count] = paid;
             count++;
         }
-        delete r; delete p;
 
         if (count == 0) { drawSuccess("No fees due!"); (void)_getch(); return; }
 
@@ -923,18 +4543,38 @@ void payFees(sql::Connection* conn, string studentUsername) {
         if (sel < 1 || sel > count) return;
 
         int i = sel - 1;
-        double remaining = dues[i] - paids[i];
+        Money remaining = dues[i] - paids[i];
 
         string amtStr = inputString("Enter Amount: ");
         if (amtStr.empty()) return;
-        double payAmt = stod(amtStr);
+        Money payAmt;
+        if (!Money::parse(amtStr, payAmt) || payAmt.cents <= 0) { drawError("Invalid amount."); (void)_getch(); return; }
+
+        conn->setAutoCommit(false); // Start transaction
+
+        // The list may come from the session cache, so lock the fee row and use its current amounts
+        sql::PreparedStatement* lock = conn->prepareStatement("SELECT AmountDue, AmountPaid FROM STUDENT_FEE WHERE SFID=? FOR UPDATE");
+        lock->setInt(1, ids[i]);
+        sql::ResultSet* lr = lock->executeQuery();
+        if (lr->next()) {
+            dues[i] = Money::fromColumn(lr->getString(1));
+            paids[i] = Money::fromColumn(lr->getString(2));
+            remaining = dues[i] - paids[i];
+        }
+        delete lr; delete lock;
+        if (remaining.cents <= 0) {
+            conn->rollback(); conn->setAutoCommit(true);
+            if (cache) cache->refresh(DS_UNPAID_FEES);
+            drawError("This fee has already been paid."); (void)_getch(); return;
+        }
 
         // Validation: Don't let them pay more than they owe
         if (payAmt > remaining) {
             payAmt = remaining;
         }
 
-        conn->setAutoCommit(false); // Start transaction
+        // Opening balance for this term, if this is the student's first payment in it
+        writeBalanceCheckpoint(conn, sid);
 
         // Use time() to make a fake transaction ID
         string tref = "PAY-" + to_string(time(0));
@@ -942,87 +4582,109 @@ void payFees(sql::Connection* conn, string studentUsername) {
         sql::PreparedStatement* ins = conn->prepareStatement("INSERT INTO PAYMENT (StudentID, SFID, Amount, TransactionRef) VALUES (?, ?, ?, ?)");
         ins->setInt(1, sid);
         ins->setInt(2, ids[i]);
-        ins->setDouble(3, payAmt);
+        ins->setString(3, payAmt.toString());
         ins->setString(4, tref);
         ins->executeUpdate();
         delete ins;
 
-        // Update the main table
-        double newPaid = paids[i] + payAmt;
-        string status = (newPaid >= dues[i]) ? "Paid" : "Partial";
+        // Update the main table (exact cents, so paying the full remainder really makes it "Paid")
+        Money newPaid = paids[i] + payAmt;
+        string status = feeStatusFor(dues[i], newPaid);
 
         sql::PreparedStatement* upd = conn->prepareStatement("UPDATE STUDENT_FEE SET AmountPaid=?, Status=? WHERE SFID=?");
-        upd->setDouble(1, newPaid);
+        upd->setString(1, newPaid.toString());
         upd->setString(2, status);
         upd->setInt(3, ids[i]);
         upd->executeUpdate();
         delete upd;
 
+        // The student's aging buckets and the campus totals move with the payment
+        refreshAging(conn, "StudentID = ?", { to_string(sid) });
+
+        // Add the payment to its course's revenue counter (same transaction)
+        sql::PreparedStatement* rev = conn->prepareStatement("INSERT INTO COURSE_REVENUE (CourseID, TotalCollected, PaymentCount) SELECT F.CourseID, ?, 1 FROM STUDENT_FEE SF JOIN FEE F ON SF.FeeID = F.FeeID WHERE SF.SFID = ? AND F.CourseID IS NOT NULL ON DUPLICATE KEY UPDATE TotalCollected = TotalCollected + VALUES(TotalCollected), PaymentCount = PaymentCount + 1");
+        rev->setString(1, payAmt.toString());
+        rev->setInt(2, ids[i]);
+        rev->executeUpdate();
+        delete rev;
+
         conn->commit();
         conn->setAutoCommit(true);
+        bumpTables({ "STUDENT_FEE", "PAYMENT", "COURSE_REVENUE", "BALANCE_CHECKPOINT" });
+        emitChange(EV_PAYMENT, sid, ids[i], payAmt.cents, tref);
+        if (cache) {
+            // Our own write: reload what it changed in the background
+            cache->refresh(DS_UNPAID_FEES); cache->refresh(DS_PAYMENTS); cache->refresh(DS_CHECKPOINT); cache->refresh(DS_SCORE);
+        }
         drawSuccess("Payment Successful! Ref: " + tref);
 
         string ask = inputString("   View Receipt? (Y/N): ");
         if (ask == "Y" || ask == "y") {
-            // Need to fetch names again for the receipt
-            string sName = "", fName = "";
-            sql::PreparedStatement* q = conn->prepareStatement("SELECT S.StudentName, F.FeeName FROM STUDENT S, FEE F WHERE S.StudentID=? AND F.FeeID=(SELECT FeeID FROM STUDENT_FEE WHERE SFID=?)");
-            q->setInt(1, sid); q->setInt(2, ids[i]);
-            sql::ResultSet* qr = q->executeQuery();
-            if (qr->next()) {
-                sName = qr->getString(1);
-                fName = qr->getString(2);
-            }
-            delete qr; delete q;
-
-            printReceipt(tref, "Now", sName, fName, payAmt);
+            // Fee name came with the list, student name was fetched in the background
+            string sName = cache ? cache->get(DS_PROFILE).text(0, 0) : nameF.get().text(0, 0);
+            printReceipt(tref, "Now", sName, feeNames[i], payAmt);
         }
     }
     catch (sql::SQLException& e) {
         conn->rollback();
+        conn->setAutoCommit(true);
         drawError(e.what());
     }
     (void)_getch();
 }
 
-void showPaymentHistory(sql::Connection* conn, int studentID) {
-    system("cls"); drawHeader("MY PAYMENT HISTORY", 11);
-
-    string query = "SELECT P.TransactionRef, P.Amount, P.PaymentDate, F.FeeName, S.StudentName FROM PAYMENT P JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID JOIN STUDENT S ON P.StudentID = S.StudentID WHERE P.StudentID = ? ORDER BY P.PaymentDate DESC";
-
-    try {
-        sql::PreparedStatement* p = conn->prepareStatement(query);
-        p->setInt(1, studentID);
-        sql::ResultSet* r = p->executeQuery();
-
-        struct ReceiptData { string ref; double amt; string date; string sName; string fName; };
-        ReceiptData history[MAX_ITEMS];
-        int count = 0;
-
-        cout << left << setw(5) << "#" << setw(20) << "Ref ID" << setw(15) << "Amount" << "Date" << endl;
-        cout << string(60, '-') << endl;
-
-        int row = 1;
-        while (r->next()) {
-            if (count >= MAX_ITEMS) break;
-            history[count].ref = r->getString("TransactionRef");
-            history[count].amt = r->getDouble("Amount");
-            history[count].date = r->getString("PaymentDate");
-            history[count].fName = r->getString("FeeName");
-            history[count].sName = r->getString("StudentName");
+// Statement for this term: the opening balance from the latest checkpoint and the
+// payments since it. "A" switches to the full history (read on demand).
+void showPaymentHistory(sql::Connection* conn, int studentID, StudentCache* cache) {
+    bool full = false;
+    while (true) {
+        system("cls"); drawHeader(full ? "MY PAYMENT HISTORY (ALL)" : "MY PAYMENT HISTORY", 11);
 
-            cout << left << setw(5) << row++ << setw(20) << history[count].ref << "$" << setw(14) << fixed << setprecision(2) << history[count].amt << history[count].date << endl;
-            count++;
-        }
-        delete r; delete p;
+        try {
+            QueryResult r;
+            if (full) {
+                r = queryPoolFor(conn).submit("SELECT P.TransactionRef, P.Amount, P.PaymentDate, F.FeeName, S.StudentName FROM PAYMENT_ALL P JOIN STUDENT_FEE SF ON P.SFID = SF.SFID JOIN FEE F ON SF.FeeID = F.FeeID JOIN STUDENT S ON P.StudentID = S.StudentID WHERE P.StudentID = ? ORDER BY P.PaymentDate DESC", { to_string(studentID) }).get();
+            }
+            else {
+                r = loadStudentData(conn, studentID, DS_PAYMENTS, cache);
+                QueryResult cp = loadStudentData(conn, studentID, DS_CHECKPOINT, cache);
+                if (cp.ok() && cp.size() > 0) {
+                    setColor(8);
+                    cout << "Opening balance " << cp.text(0, 0) << ": billed $" << cp.money(0, 1).toString() << ", paid $" << cp.money(0, 2).toString()
+                        << " (" << cp.integer(0, 3) << " earlier payments)" << endl << endl;
+                    setColor(7);
+                }
+            }
+            if (!r.ok()) throw sql::SQLException(r.error);
+
+            struct ReceiptData { string ref; Money amt; string date; string sName; string fName; };
+            ReceiptData history[MAX_ITEMS];
+            int count = 0;
+
+            cout << left << setw(5) << "#" << setw(20) << "Ref ID" << setw(15) << "Amount" << "Date" << endl;
+            cout << string(60, '-') << endl;
+
+            int row = 1;
+            for (size_t i = 0; i < r.size(); i++) {
+                if (count >= MAX_ITEMS) break;
+                history[count].ref = r.text(i, 0);
+                history[count].amt = r.money(i, 1);
+                history[count].date = r.text(i, 2);
+                history[count].fName = r.text(i, 3);
+                history[count].sName = r.text(i, 4);
+
+                cout << left << setw(5) << row++ << setw(20) << history[count].ref << "$" << setw(14) << history[count].amt.toString() << history[count].date << endl;
+                count++;
+            }
 
-        if (count == 0) {
-            drawError("No payment history found.");
-            (void)_getch(); return;
-        }
+            if (count == 0) {
+                drawError(full ? "No payment history found." : "No payments this term.");
+                if (full) { (void)_getch(); return; }
+            }
 
-        string input = inputString("\nEnter # to view receipt (or ENTER to back): ");
-        if (!input.empty()) {
+            string input = inputString(full ? "\nEnter # to view receipt (or ENTER to back): " : "\nEnter # to view receipt, A for all history (or ENTER to back): ");
+            if (input.empty()) return;
+            if (!full && (input == "A" || input == "a")) { full = true; continue; }
             try {
                 int idx = stoi(input);
                 if (idx >= 1 && idx <= count) {
@@ -1031,61 +4693,77 @@ void showPaymentHistory(sql::Connection* conn, int studentID) {
                 }
             }
             catch (...) {}
+            return;
         }
+        catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); return; }
     }
-    catch (sql::SQLException& e) { drawError(e.what()); (void)_getch(); }
 }
 
-void showMyScore(sql::Connection* conn, int studentID) {
-    system("cls"); drawHeader("MY PERFORMANCE REPORT", 11);
-    string query = "SELECT * FROM ( SELECT S.StudentID, S.StudentName, (SUM(CASE WHEN A.Status='Present' THEN 1.0 ELSE 0.0 END) / COUNT(A.AttendanceID)) * 100.0 AS AttRate, (SUM(SF.AmountPaid) / SUM(SF.AmountDue)) * 100.0 AS PayRate FROM STUDENT S JOIN ATTENDANCE A ON S.StudentID = A.StudentID JOIN STUDENT_FEE SF ON S.StudentID = SF.StudentID GROUP BY S.StudentID) AS T WHERE StudentID = ?";
+// Scored on this term's attendance; H re-scores over every term
+void showMyScore(sql::Connection* conn, int studentID, StudentCache* cache) {
+    bool history = false;
+    while (true) {
+        system("cls"); drawHeader(history ? "MY PERFORMANCE REPORT (ALL TERMS)" : "MY PERFORMANCE REPORT", 11);
 
-    try {
-        sql::PreparedStatement* p = conn->prepareStatement(query);
-        p->setInt(1, studentID);
-        sql::ResultSet* res = p->executeQuery();
-
-        if (res->next()) {
-            string name = res->getString("StudentName");
-            double att = res->getDouble("AttRate");
-            double pay = res->getDouble("PayRate");
-            double score = (att + pay) / 2.0;
-
-            string rating; int color;
-            if (score >= 95) { rating = "S (Elite)"; color = 11; }
-            else if (score >= 85) { rating = "A (Good)";  color = 10; }
-            else if (score >= 70) { rating = "B (Avg)";   color = 14; }
-            else if (score >= 50) { rating = "C (Risk)";  color = 12; }
-            else { rating = "F (Fail)";  color = 4; }
-
-            cout << "\n   " << left << setw(20) << "Student Name:" << name << endl;
-            cout << "   " << string(40, '-') << endl;
-            cout << "   " << left << setw(20) << "Attendance Rate:";
-            if (att >= 80) setColor(10); else setColor(12);
-            cout << fixed << setprecision(0) << att << "%" << endl; setColor(7);
-            cout << "   " << left << setw(20) << "Fee Payment Rate:";
-            if (pay >= 80) setColor(10); else setColor(12);
-            cout << fixed << setprecision(0) << pay << "%" << endl; setColor(7);
-            cout << "   " << string(40, '-') << endl;
-            cout << "   " << left << setw(20) << "OVERALL SCORE:";
-            setColor(color); cout << fixed << setprecision(1) << score << " / 100" << endl; setColor(7);
-            cout << "   " << left << setw(20) << "RATING:";
-            setColor(color); cout << rating << endl; setColor(7);
-            cout << "   " << string(40, '-') << endl;
-            if (score < 70) cout << "\n   [TIP] To improve, attend more classes or clear outstanding fees.";
-            else cout << "\n   [INFO] Keep up the great work!";
-        }
-        else {
-            drawError("Not enough data to calculate your score yet.");
-            cout << "   (You need at least 1 attendance record and 1 fee record)";
+        try {
+            QueryResult res = loadStudentData(conn, studentID, DS_SCORE, cache, history);
+            if (!res.ok()) throw sql::SQLException(res.error);
+
+            if (res.size() > 0) {
+                string name = res.text(0, 1);
+                double att = res.num(0, 2);
+                double pay = res.num(0, 3);
+                double score = (att + pay) / 2.0;
+
+                string rating; int color;
+                if (score >= 95) { rating = "S (Elite)"; color = 11; }
+                else if (score >= 85) { rating = "A (Good)";  color = 10; }
+                else if (score >= 70) { rating = "B (Avg)";   color = 14; }
+                else if (score >= 50) { rating = "C (Risk)";  color = 12; }
+                else { rating = "F (Fail)";  color = 4; }
+
+                cout << "\n   " << left << setw(20) << "Student Name:" << name << endl;
+                cout << "   " << string(40, '-') << endl;
+                cout << "   " << left << setw(20) << "Attendance Rate:";
+                if (att >= 80) setColor(10); else setColor(12);
+                cout << fixed << setprecision(0) << att << "%" << endl; setColor(7);
+                cout << "   " << left << setw(20) << "Fee Payment Rate:";
+                if (pay >= 80) setColor(10); else setColor(12);
+                cout << fixed << setprecision(0) << pay << "%" << endl; setColor(7);
+                cout << "   " << string(40, '-') << endl;
+                cout << "   " << left << setw(20) << "OVERALL SCORE:";
+                setColor(color); cout << fixed << setprecision(1) << score << " / 100" << endl; setColor(7);
+                cout << "   " << left << setw(20) << "RATING:";
+                setColor(color); cout << rating << endl; setColor(7);
+                cout << "   " << string(40, '-') << endl;
+
+                // Recent trend from the in-memory attendance windows
+                AttendanceWindow w = studentWindow(conn, studentID, cache);
+                double recent = w.recentRate(), term = w.termRate();
+                cout << "   " << left << setw(20) << "Last 4 Weeks:";
+                if (recent < 0) cout << "no classes" << endl;
+                else { if (recent >= 80) setColor(10); else setColor(12); cout << fixed << setprecision(0) << recent << "% (" << w.recentPresent << "/" << w.recentTotal << ")" << endl; setColor(7); }
+                cout << "   " << left << setw(20) << "This Term:";
+                if (term < 0) cout << "no classes" << endl;
+                else { if (term >= 80) setColor(10); else setColor(12); cout << fixed << setprecision(0) << term << "% (" << w.termPresent << "/" << w.termTotal << ")" << endl; setColor(7); }
+                cout << "   " << string(40, '-') << endl;
+                if (score < 70) cout << "\n   [TIP] To improve, attend more classes or clear outstanding fees.";
+                else cout << "\n   [INFO] Keep up the great work!";
+            }
+            else {
+                drawError("Not enough data to calculate your score yet.");
+                cout << "   (You need at least 1 attendance record and 1 fee record)";
+            }
         }
-        delete res; delete p;
+        catch (sql::SQLException& e) { drawError(e.what()); }
+        cout << "\n\n   [H] " << (history ? "This term only" : "Include history") << "   Any other key to go back...";
+        char key = (char)_getch();
+        if (key != 'h' && key != 'H') return;
+        history = !history;
     }
-    catch (sql::SQLException& e) { drawError(e.what()); }
-    cout << "\n\nPress any key..."; (void)_getch();
 }
 
-void updateStudent(sql::Connection* conn, string username) {
+void updateStudent(sql::Connection* conn, string username, StudentCache* cache) {
     system("cls"); drawHeader("UPDATE PROFILE", 13);
     string newName = inputString("New Name: ");
     string newPass = inputString("New Password: ");
@@ -1093,7 +4771,14 @@ void updateStudent(sql::Connection* conn, string username) {
     if (!newName.empty()) { query += "StudentName='" + newName + "'"; first = false; }
     if (!newPass.empty()) { if (!first) query += ", "; query += "Password='" + newPass + "'"; first = false; }
     query += " WHERE Username='" + username + "'";
-    try { if (!first) { sql::Statement* s = conn->createStatement(); s->executeUpdate(query); delete s; drawSuccess("Updated."); } }
+    try {
+        if (!first) {
+            sql::Statement* s = conn->createStatement(); s->executeUpdate(query); delete s; drawSuccess("Updated.");
+            bumpTables({ "STUDENT" });
+            emitChange(EV_STUDENT_UPDATED, 0, 0, 0, username);
+            if (cache && !newName.empty()) { cache->refresh(DS_PROFILE); cache->refresh(DS_PAYMENTS); cache->refresh(DS_SCORE); }
+        }
+    }
     catch (...) { drawError("Fail."); }
     (void)_getch();
 }
@@ -1106,7 +4791,7 @@ void updateTeacher(sql::Connection* conn, string username) {
     if (!newName.empty()) { query += "TeacherName='" + newName + "'"; first = false; }
     if (!newPass.empty()) { if (!first) query += ", "; query += "Password='" + newPass + "'"; first = false; }
     query += " WHERE Username='" + username + "'";
-    try { if (!first) { sql::Statement* s = conn->createStatement(); s->executeUpdate(query); delete s; drawSuccess("Updated."); } }
+    try { if (!first) { sql::Statement* s = conn->createStatement(); s->executeUpdate(query); delete s; bumpTables({ "TEACHER" }); emitChange(EV_TEACHER_UPDATED, 0, 0, 0, username); drawSuccess("Updated."); } }
     catch (...) { drawError("Fail."); }
     (void)_getch();
 }
@@ -1118,20 +4803,54 @@ void deleteUser(sql::Connection* conn) {
     if (inputString("Type CONFIRM: ") != "CONFIRM") return;
     try {
         string t = (type == "Teacher") ? "TEACHER" : "STUDENT";
+        int sid = -1;
+        if (t == "STUDENT") {
+            sql::PreparedStatement* q = conn->prepareStatement("SELECT StudentID FROM STUDENT WHERE Username=?");
+            q->setString(1, target); sql::ResultSet* qr = q->executeQuery();
+            if (qr->next()) sid = qr->getInt(1);
+            delete qr; delete q;
+        }
+        conn->setAutoCommit(false);
+        // The history tables and WAITLIST have no foreign keys, so a student's rows there
+        // are removed by hand, and the seats they held are given back
+        vector<int> seatCourses;
+        if (sid != -1) {
+            for (string h : { "ATTENDANCE_HISTORY", "PAYMENT_HISTORY", "WAITLIST" }) {
+                sql::PreparedStatement* hd = conn->prepareStatement("DELETE FROM " + h + " WHERE StudentID=?");
+                hd->setInt(1, sid); hd->executeUpdate(); delete hd;
+            }
+            sql::PreparedStatement* sc = conn->prepareStatement("SELECT CourseID FROM STUDENT_COURSE WHERE StudentID=?");
+            sc->setInt(1, sid); sql::ResultSet* scr = sc->executeQuery();
+            while (scr->next()) seatCourses.push_back(scr->getInt(1));
+            delete scr; delete sc;
+            sql::PreparedStatement* rel = conn->prepareStatement("UPDATE COURSE SET SeatsTaken = GREATEST(SeatsTaken - 1, 0) WHERE CourseID IN (SELECT CourseID FROM STUDENT_COURSE WHERE StudentID=?)");
+            rel->setInt(1, sid); rel->executeUpdate(); delete rel;
+        }
         sql::PreparedStatement* p = conn->prepareStatement("DELETE FROM " + t + " WHERE Username=?");
         p->setString(1, target); int r = p->executeUpdate(); delete p;
+        // The freed seats go to the head of each course's waitlist
+        for (int cid : seatCourses) promoteWaitlist(conn, cid);
+        // Drop a deleted student's aging row if their fees went with them
+        if (r > 0 && sid != -1) refreshAging(conn, "StudentID = ?", { to_string(sid) });
+        conn->commit();
+        // Foreign keys take the account's enrollments, fees and payments (or course assignments) with it
+        if (r > 0) {
+            bumpTables({ t, "STUDENT_COURSE", "STUDENT_FEE", "PAYMENT", "ATTENDANCE", "PAYMENT_HISTORY", "ATTENDANCE_HISTORY", "COURSE", "WAITLIST" });
+            emitChange(t == "STUDENT" ? EV_STUDENT_DELETED : EV_TEACHER_DELETED, sid, 0, 0, target);
+        }
         if (r > 0) drawSuccess("Deleted."); else drawError("Not found.");
     }
-    catch (...) { drawError("Fail."); }
+    catch (...) { try { conn->rollback(); } catch (...) {} drawError("Fail."); }
+    conn->setAutoCommit(true);
     (void)_getch();
 }
 
 void adminMenu(sql::Connection* conn, string username) {
     string ops[] = {
         "Register Account", "View Database Records", "Delete Account",
-        "Manage Courses", "Analytics Dashboard", "Logout"
+        "Manage Courses", "Analytics Dashboard", "Data Tools", "Logout"
     };
-    int opCount = 6;
+    int opCount = 7;
     int choice = 0;
     system("cls");
 
@@ -1172,9 +4891,9 @@ void adminMenu(sql::Connection* conn, string username) {
             system("cls");
             while (true) {
                 string aops[] = {
-                    "General Reports", "Student Reliability Score", "Unpaid Fees List", "Back"
+                    "General Reports", "Student Reliability Score", "Unpaid Fees List", "At-Risk Students", "Back"
                 };
-                int aCount = 4;
+                int aCount = 5;
                 int ach = 0;
                 while (true) {
                     drawMenuFrame("ANALYTICS", aops, aCount, ach);
@@ -1183,15 +4902,18 @@ void adminMenu(sql::Connection* conn, string username) {
                     if (k == 80) ach = (ach + 1) % aCount;
                     if (k == 13) break;
                 }
-                if (ach == 3) break;
-                if (ach == 0) showAdminStats(conn);
-                if (ach == 1) showReliabilityScore(conn);
-                if (ach == 2) showDebtList(conn);
+                if (ach == 4) break;
+                // Reports are read-only, so they can run on a replica
+                if (ach == 0) showAdminStats(readConnection(conn));
+                if (ach == 1) showReliabilityScore(readConnection(conn));
+                if (ach == 2) { sweepAgingAll(conn); showDebtList(readConnection(conn)); }
+                if (ach == 3) showAtRiskStudents(conn);
                 system("cls");
             }
             system("cls");
         }
-        else if (choice == 5) break;
+        else if (choice == 5) dataToolsMenu(conn);
+        else if (choice == 6) break;
         system("cls");
     }
 }
@@ -1208,6 +4930,10 @@ void teacherMenu(sql::Connection* conn, string username) {
     }
     catch (...) {}
 
+    // Today's roster for every section loads while the menu is up
+    TeacherRoster roster(conn, tid);
+    roster.load();
+
     system("cls");
     while (true) {
         while (true) {
@@ -1217,9 +4943,22 @@ void teacherMenu(sql::Connection* conn, string username) {
             else if (key == 80) choice = (choice + 1) % opCount;
             else if (key == 13) break;
         }
-        if (choice == 0) takeAttendance(conn, tid);
+        if (choice == 0) takeAttendance(conn, tid, &roster);
         else if (choice == 1) updateTeacher(conn, username);
-        else if (choice == 2) break;
+        else if (choice == 2) {
+            int unsaved = roster.unsaved();
+            if (unsaved > 0) {
+                system("cls"); drawHeader("LOGOUT", 11);
+                string ask = inputString("   " + to_string(unsaved) + " attendance changes are not saved. Save them now? (Y/N): ");
+                if (ask == "Y" || ask == "y") {
+                    string err = roster.save();
+                    if (err.empty()) drawSuccess("Attendance Saved (Updated).");
+                    else drawError(err);
+                    (void)_getch();
+                }
+            }
+            break;
+        }
         system("cls");
     }
 }
@@ -1233,6 +4972,10 @@ void studentMenu(sql::Connection* conn, string username) {
     int choice = 0;
     int sid = getStudentID(conn, username);
 
+    // Start loading every screen's data while the menu is drawn
+    StudentCache cache(conn, sid);
+    if (sid != -1) cache.prefetchAll();
+
     system("cls");
     while (true) {
         while (true) {
@@ -1242,34 +4985,68 @@ void studentMenu(sql::Connection* conn, string username) {
             else if (key == 80) choice = (choice + 1) % opCount;
             else if (key == 13) break;
         }
-        if (choice == 0) viewAttendance(conn, sid);
-        else if (choice == 1) payFees(conn, username);
-        else if (choice == 2) showPaymentHistory(conn, sid);
-        else if (choice == 3) showMyScore(conn, sid);
-        else if (choice == 4) updateStudent(conn, username);
+        if (choice == 0) viewAttendance(conn, sid, &cache);
+        else if (choice == 1) payFees(conn, username, &cache);
+        else if (choice == 2) showPaymentHistory(conn, sid, &cache);
+        else if (choice == 3) showMyScore(conn, sid, &cache);
+        else if (choice == 4) updateStudent(conn, username, &cache);
         else if (choice == 5) break;
         system("cls");
     }
 }
 
-int login(sql::Connection* conn, string role, string& outUser) {
+// outHome is the connection the user's data lives on: conn, or their campus when sharded
+int login(sql::Connection* conn, string role, string& outUser, sql::Connection*& outHome) {
     system("cls"); drawHeader(role + " LOGIN", 11);
     string u = inputString("Username: ");
     string p = inputString("Password: ", true);
     string q;
+    outHome = conn;
     if (role == "Admin") { if (u == "admin" && p == "admin") { outUser = u; return 1; } return -1; }
     else if (role == "Teacher") q = "SELECT * FROM TEACHER WHERE Username=?";
     else q = "SELECT * FROM STUDENT WHERE Username=?";
+
+    if (dbConfig.shardCount > 0) {
+        // Find the campus that has this username, asking all of them at once
+        vector<ShardResult> parts = scatterQuery(conn, "SELECT Password FROM " + string(role == "Teacher" ? "TEACHER" : "STUDENT") + " WHERE Username=?", { u });
+        int home = -1, found = 0;
+        string down;
+        for (int i = 0; i < (int)parts.size(); i++) {
+            if (!parts[i].result.ok()) { if (down.empty()) down = parts[i].campus; continue; }
+            if (parts[i].result.size() > 0) { found++; home = i; }
+        }
+        // Registration keeps usernames unique across campuses; older duplicates can't be told apart
+        if (found > 1) { drawError("This username exists on more than one campus. Ask the admin to rename one."); (void)_getch(); return -1; }
+        if (found == 0 && !down.empty()) { drawError(down + " campus is unavailable. Try again later."); (void)_getch(); return -1; }
+        if (found == 1 && parts[home].result.text(0, 0) == p) {
+            outHome = shardConnection(home);
+            if (outHome) { outUser = u; return 1; }
+            drawError(parts[home].campus + " campus is unavailable. Try again later."); (void)_getch(); return -1;
+        }
+        drawError("Invalid Login"); (void)_getch(); return -1;
+    }
+
     try {
         sql::PreparedStatement* ps = conn->prepareStatement(q);
         ps->setString(1, u); sql::ResultSet* r = ps->executeQuery();
         if (r->next()) { if (r->getString("Password") == p) { outUser = u; delete r; delete ps; return 1; } }
         delete r; delete ps;
     }
-    catch (...) {}
+    catch (...) { drawError("The database is unavailable. Try again later."); (void)_getch(); return -1; }
     drawError("Invalid Login"); (void)_getch(); return -1;
 }
 
+// Registration check. With campuses a username must be unique across all of them, or
+// login could not tell which campus the account lives on. Returns "" when it is free.
+string usernameTakenError(sql::Connection* conn, const string& table, const string& user) {
+    vector<ShardResult> parts = scatterQuery(conn, "SELECT 1 FROM " + table + " WHERE Username=?", { user });
+    for (const ShardResult& part : parts) {
+        if (!part.result.ok()) return part.campus + " campus is unavailable, so the username can't be checked. Try again later.";
+        if (part.result.size() > 0) return dbConfig.shardCount > 0 ? "Username already taken (" + part.campus + " campus)." : "Username already taken.";
+    }
+    return "";
+}
+
 void registerUser(sql::Connection* conn) {
     string ops[] = { "Register Teacher", "Register Student", "Back" };
     int opCount = 3;
@@ -1288,9 +5065,11 @@ void registerUser(sql::Connection* conn) {
         string name = inputString("Full Name: ");
         string user = inputString("Username: ");
         string pass = inputString("Password: ", true);
+        string taken = usernameTakenError(conn, choice == 0 ? "TEACHER" : "STUDENT", user);
+        if (!taken.empty()) { drawError(taken); (void)_getch(); system("cls"); continue; }
 
         if (choice == 0) {
-            int cid = 0; string cname; double dummy;
+            int cid = 0; string cname; Money dummy;
             cout << "\nSelect Course to Assign:\n";
             if (!selectCourse(conn, cid, cname, dummy)) { (void)_getch(); system("cls"); continue; }
             try {
@@ -1304,13 +5083,15 @@ void registerUser(sql::Connection* conn) {
                     sql::PreparedStatement* up = conn->prepareStatement("UPDATE COURSE SET Lecturer_ID=? WHERE CourseID=?");
                     up->setInt(1, tid); up->setInt(2, cid); up->executeUpdate(); delete up;
                 }
-                conn->commit(); drawSuccess("Teacher Registered & Assigned to " + cname);
+                conn->commit(); bumpTables({ "TEACHER", "COURSE" });
+                emitChange(EV_TEACHER_ADDED, tid, cid, 0, user);
+                drawSuccess("Teacher Registered & Assigned to " + cname);
             }
             catch (...) { conn->rollback(); drawError("Registration Fail."); }
             conn->setAutoCommit(true);
         }
         else {
-            int cid = 0; string cname; double dummy;
+            int cid = 0; string cname; Money dummy;
             cout << "\nSelect Course for Enrollment:\n";
             if (!selectCourse(conn, cid, cname, dummy)) { (void)_getch(); system("cls"); continue; }
             try {
@@ -1318,9 +5099,15 @@ void registerUser(sql::Connection* conn) {
                 sql::PreparedStatement* p = conn->prepareStatement("INSERT INTO STUDENT (StudentName, Username, Password) VALUES (?,?,?)");
                 p->setString(1, name); p->setString(2, user); p->setString(3, pass); p->executeUpdate(); delete p;
                 int sid = getStudentID(conn, user);
-                sql::PreparedStatement* e = conn->prepareStatement("INSERT INTO STUDENT_COURSE (StudentID, CourseID) VALUES (?,?)");
-                e->setInt(1, sid); e->setInt(2, cid); e->executeUpdate(); delete e;
-                conn->commit(); drawSuccess("Student Registered!"); cout << "   (Tuition has been automatically billed)\n";
+                bool seat = reserveSeat(conn, sid, cid, LIVE_SEATS);
+                int place = seat ? 0 : waitlistPosition(conn, sid, cid);
+                if (seat) refreshAging(conn, "StudentID = ?", { to_string(sid) }); // the enrollment billed tuition
+                conn->commit(); bumpTables({ "STUDENT", "STUDENT_COURSE", "STUDENT_FEE", "COURSE", "WAITLIST" });
+                emitChange(EV_STUDENT_ADDED, sid, 0, 0, user);
+                emitChange(seat ? EV_ENROLLED : EV_WAITLISTED, sid, cid, 0, cname);
+                drawSuccess("Student Registered!");
+                if (seat) cout << "   (Tuition has been automatically billed)\n";
+                else cout << "   " << cname << " is full. Added to the waitlist at position " << place << ".\n";
             }
             catch (sql::SQLException& e) { conn->rollback(); drawError(e.what()); }
             conn->setAutoCommit(true);
@@ -1330,13 +5117,189 @@ void registerUser(sql::Connection* conn) {
     }
 }
 
+// ===================== STARTUP =====================
+// The main menu is drawn straight away. Connecting (with retries), the schema checks
+// and warming the query pools run on a background thread, and each step is timed
+// from process start so startup.log can be compared release over release.
+const chrono::steady_clock::time_point processStart = chrono::steady_clock::now();
+
+struct StartupState {
+    mutex m;
+    condition_variable changed;
+    sql::Connection* conn = nullptr; // set once the primary is connected and its schema checked
+    bool ready = false, warm = false, quitting = false;
+    int attempts = 0;
+    string lastError, schemaError;
+    chrono::steady_clock::time_point nextRetry;
+    vector<pair<string, double>> timeline; // step name -> ms since process start
+};
+
+StartupState startup;
+thread startupThread;
+
+void markStartup(const string& step) {
+    lock_guard<mutex> lock(startup.m);
+    startup.timeline.push_back({ step, secondsSince(processStart) * 1000.0 });
+}
+
+// Tries the primary until it answers, waiting 0.5s, 1s, 2s ... (at most 30s) between
+// attempts. Returns nullptr only if the program is closing.
+sql::Connection* connectDB() {
+    int backoffMs = 500;
+    while (true) {
+        try {
+            sql::Connection* conn = openConnection(dbConfig.primaryHost);
+            lock_guard<mutex> lock(startup.m);
+            startup.attempts++;
+            return conn;
+        }
+        catch (sql::SQLException& e) {
+            unique_lock<mutex> lock(startup.m);
+            startup.attempts++;
+            startup.lastError = e.what();
+            startup.nextRetry = chrono::steady_clock::now() + chrono::milliseconds(backoffMs);
+            startup.changed.notify_all();
+            if (startup.changed.wait_for(lock, chrono::milliseconds(backoffMs), [] { return startup.quitting; })) return nullptr;
+        }
+        backoffMs = min(backoffMs * 2, 30000);
+    }
+}
+
+void startupWorker() {
+    sql::mysql::get_driver_instance()->threadInit();
+    sql::Connection* conn = connectDB();
+    if (conn) {
+        markStartup("connected");
+        string err = ensureSchema(conn);
+        // Campus connections are set up here and only published to shardConns with
+        // startup.ready, so the menu thread never shares one with this thread.
+        // Campuses that are down now are retried by shardConnection() when first used.
+        sql::Connection* campus[MAX_SHARDS] = {};
+        for (int i = 0; i < dbConfig.shardCount; i++) {
+            try {
+                campus[i] = openConnection(dbConfig.shardHosts[i], dbConfig.shardSchemas[i]);
+                string shardErr = ensureSchema(campus[i]);
+                if (err.empty() && !shardErr.empty()) err = dbConfig.shardNames[i] + ": " + shardErr;
+            }
+            catch (sql::SQLException&) { delete campus[i]; campus[i] = nullptr; }
+        }
+        // Daily debt aging sweep, so the first report of the day doesn't wait for it
+        for (int i = -1; i < dbConfig.shardCount; i++) {
+            sql::Connection* c = (i == -1) ? conn : campus[i];
+            if (!c || (i == -1 && dbConfig.shardCount > 0)) continue;
+            try { sweepAging(c); }
+            catch (sql::SQLException& e) { if (err.empty()) err = "Debt aging sweep: " + string(e.what()); }
+        }
+        bool campusUp[MAX_SHARDS] = {};
+        for (int i = 0; i < dbConfig.shardCount; i++) campusUp[i] = campus[i] != nullptr;
+        markStartup("db_ready");
+        {
+            lock_guard<mutex> lock(startup.m);
+            for (int i = 0; i < dbConfig.shardCount; i++) shardConns[i] = campus[i];
+            startup.conn = conn; startup.ready = true; startup.schemaError = err;
+        }
+        startup.changed.notify_all();
+
+        // Open the query pools' connections and pull the course and fee catalog into the
+        // server's buffer pool, so the first report doesn't pay for it
+        vector<future<QueryResult>> warmups;
+        for (int i = 0; i <= dbConfig.shardCount; i++) {
+            if (i < dbConfig.shardCount && !campusUp[i]) continue;
+            QueryPool& pool = (i == dbConfig.shardCount)
+                ? queryPoolFor(dbConfig.primaryHost, dbConfig.schema)
+                : queryPoolFor(dbConfig.shardHosts[i], dbConfig.shardSchemas[i]);
+            warmups.push_back(pool.submit("SELECT CourseID, CourseName, CreditHours FROM COURSE"));
+            warmups.push_back(pool.submit("SELECT FeeID, FeeName, Amount, CourseID FROM FEE"));
+        }
+        for (auto& f : warmups) f.wait();
+        markStartup("caches_warm");
+        { lock_guard<mutex> lock(startup.m); startup.warm = true; }
+        startup.changed.notify_all();
+    }
+    sql::mysql::get_driver_instance()->threadEnd();
+}
+
+void beginStartup() {
+    const char* cfg = getenv("SFAMS_DB_CONFIG");
+    loadDBConfig(cfg ? cfg : "db.ini");
+    startupThread = thread(startupWorker);
+}
+
+// Stops the retry loop if we never connected and waits for the startup thread
+void endStartup() {
+    { lock_guard<mutex> lock(startup.m); startup.quitting = true; }
+    startup.changed.notify_all();
+    if (startupThread.joinable()) startupThread.join();
+}
+
+// One line for the main menu, e.g. "Database: connecting (attempt 3, retry in 4s)"
+string startupStatus() {
+    lock_guard<mutex> lock(startup.m);
+    if (startup.ready) {
+        if (!startup.schemaError.empty()) return "Database: connected (schema check failed: " + startup.schemaError.substr(0, 40) + ")";
+        return startup.warm ? "Database: ready" : "Database: connected, warming up...";
+    }
+    if (startup.attempts == 0) return "Database: connecting...";
+    int wait = (int)ceil(chrono::duration<double>(startup.nextRetry - chrono::steady_clock::now()).count());
+    return "Database: unreachable (attempt " + to_string(startup.attempts) + ", retry in " + to_string(max(wait, 0)) + "s)";
+}
+
+void drawStartupStatus() {
+    string status = startupStatus();
+    bool ok;
+    { lock_guard<mutex> lock(startup.m); ok = startup.ready && startup.schemaError.empty(); }
+    cout << "\n";
+    setColor(ok ? 10 : 14);
+    printCentered(status + string(status.length() < 70 ? 70 - status.length() : 0, ' ')); // pad over the previous text
+    setColor(7);
+}
+
+// Called when the user picks a login. Waits for the connection, showing the retries.
+// Returns nullptr if the user presses ESC.
+sql::Connection* waitForDatabase() {
+    {
+        lock_guard<mutex> lock(startup.m);
+        if (startup.ready) return startup.conn;
+    }
+    system("cls");
+    drawHeader("CONNECTING TO DATABASE", 11);
+    while (true) {
+        {
+            lock_guard<mutex> lock(startup.m);
+            if (startup.ready) { system("cls"); return startup.conn; }
+        }
+        gotoxy(0, 5);
+        string status = startupStatus();
+        setColor(14); printCentered(status + string(status.length() < 70 ? 70 - status.length() : 0, ' '));
+        string err;
+        { lock_guard<mutex> lock(startup.m); err = startup.lastError; }
+        setColor(8); printCentered(err.substr(0, 70) + string(err.length() < 70 ? 70 - err.length() : 0, ' '));
+        printCentered("[ESC] Back to menu");
+        setColor(7);
+        if (_kbhit() && _getch() == 27) { system("cls"); return nullptr; }
+        Sleep(200);
+    }
+}
+
+// Appends one line per run: the date and each startup step in ms
+void writeStartupLog() {
+    ofstream log("startup.log", ios::app);
+    if (!log) return;
+    time_t t = time(0); char buf[32]; strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    lock_guard<mutex> lock(startup.m);
+    log << buf;
+    for (auto& step : startup.timeline) log << " " << step.first << "=" << fixed << setprecision(0) << step.second << "ms";
+    log << " attempts=" << startup.attempts << "\n";
+}
+
 int main() {
     HWND hwnd = GetConsoleWindow();
     if (hwnd != NULL) { ShowWindow(hwnd, SW_MAXIMIZE); }
     hideCursor();
 
-    sql::Connection* conn = connectDB();
-    drawLoadingScreen(conn);
+    // Connects in the background; the menu works straight away
+    beginStartup();
+    bool painted = false;
 
     string ops[] = {
         "Admin Login",
@@ -1351,20 +5314,44 @@ int main() {
     while (true) {
         while (true) {
             drawMenuFrame("MAIN MENU", ops, opCount, choice);
+            drawStartupStatus();
+            if (!painted) { markStartup("first_paint"); painted = true; }
+            // Keep the connection status current until a key is pressed
+            string shown = startupStatus();
+            while (!_kbhit()) {
+                Sleep(100);
+                if (startupStatus() != shown) { shown = startupStatus(); drawMenuFrame("MAIN MENU", ops, opCount, choice); drawStartupStatus(); }
+            }
             char key = (char)_getch();
             if (key == 72) choice = (choice - 1 + opCount) % opCount;
             else if (key == 80) choice = (choice + 1) % opCount;
             else if (key == 13) break;
         }
 
-        if (choice == 0) { string u; if (login(conn, "Admin", u) != -1) adminMenu(conn, u); }
-        else if (choice == 1) { string u; if (login(conn, "Teacher", u) != -1) teacherMenu(conn, u); }
-        else if (choice == 2) { string u; if (login(conn, "Student", u) != -1) studentMenu(conn, u); }
-        else break;
+        if (choice == opCount - 1) break;
+        sql::Connection* conn = waitForDatabase();
+        if (!conn) continue;
+
+        sql::Connection* home = conn;
+        if (choice == 0) {
+            string u;
+            if (login(conn, "Admin", u, home) != -1) {
+                // With several campuses the admin manages one at a time (analytics still cover all)
+                if (dbConfig.shardCount == 0) adminMenu(conn, u);
+                else { int campus = chooseCampus(); if (campus != -1 && shardConnection(campus)) adminMenu(shardConnection(campus), u); }
+            }
+        }
+        else if (choice == 1) { string u; if (login(conn, "Teacher", u, home) != -1) teacherMenu(home, u); }
+        else if (choice == 2) { string u; if (login(conn, "Student", u, home) != -1) studentMenu(home, u); }
 
         system("cls");
     }
-    delete conn;
+    endStartup();
+    writeStartupLog();
+    closeQueryPools();
+    changeLog.close();
+    closeReplicas();
+    delete startup.conn;
     return 0;
 
 }